@@ -31,7 +31,6 @@ if(~isempty(m2) && ~isempty(n2))
     m2 = mvec(m2);
     n2 = mvec(n2);
     R2 = m2*n2;
-    R2c = ~R2;
 end
 
 if(~exist('h','var') || isempty(h))
@@ -53,24 +52,15 @@ data(:,:,3) = get(h,'zdata');
 data = shiftdim(data,2);
 [D,N1,N2] = size(data);
 data = reshape(data,3,N1*N2);
-N = size(data,2);
-
-a = cell(N,1);
-for i=1:N
-    a{i} = mvec(data(:,i));
-end
 
 for f=1:200
     if(~isempty(m2) && ~isempty(n2))   
         R2 = R*R2*Rc;
-        R2c = ~R2;
     end
-    for i=1:N
-       a{i} = R*a{i}*Rc;
-       if(~isempty(m2) && ~isempty(n2))   
-          a{i} = R2*a{i}*R2c; 
-       end
-       data(:,i) = a{i}.vec(3);
+    % All vertices are rotated in one call
+    data = R.apply(data);
+    if(~isempty(m2) && ~isempty(n2))   
+        data = R2.apply(data);
     end
     data = reshape(data,3,N1,N2);
     data = shiftdim(data,1);
@@ -1,55 +1,185 @@
 #include "mex.h"
 
 #include "mxMvec.h"
+#include <Batch>
 #include <iostream>
 #include <stdio.h>
 
 using namespace std;
+using namespace gca;
 
 void help(void) {
     mexErrMsgTxt("Error!");
 }
 
+void cleanup(void) {
+    mxHandles::clear();
+}
+
+/* Operand of a command: a handle is used in place, anything else (an
+   mvec object, cell data, a number or a vector) is converted into tmp.
+   handle is set when the operand lives in the handle table. */
+const Mvec& operand(const mxArray *a, mxMvec &tmp, bool &handle) {
+    if(mxHandles::isHandle(a)) {
+        handle = true;
+        return mxHandles::get(a);
+    }
+    if(mxIsClass(a,"mvec")) {
+        handle = true;
+    }
+    tmp = mxMvec(a);
+    return tmp;
+}
+
+/* Results of commands on handles are new handles, otherwise cell data */
+mxArray *result(const Mvec &m, bool handle) {
+    if(handle) {
+        return mxHandles::insert(m);
+    }
+    mxMvec c(m);
+    return c.convert2mxArray();
+}
+
 void mexFunction(int nlhs, mxArray *plhs[ ], int nrhs, const mxArray *prhs[]) {
 
-   if(!mxIsChar(prhs[0])) {
+   mexAtExit(cleanup);
+
+   if(nrhs < 1 || !mxIsChar(prhs[0])) {
        help();
    }
-   
+
    char *cmd = (char *) mxGetPr(prhs[0]);
-   
+
 
    switch(*cmd) {
 
-       case 'n': {
+       case 'n':
+       case 'N': {
+           if(nrhs < 2) {
+               help();
+           }
+
+           mxMvec tmp;
+           bool handle = (*cmd == 'N');
+           const Mvec &m = operand(prhs[1], tmp, handle);
+           plhs[0] = result(m, handle);
+           break;
+
+       }
+
+       case 'd': {
            if(nrhs < 2) {
                help();
            }
 
-           mxMvec m(prhs[1]);
+           mxMvec tmp;
+           bool handle = false;
+           mxMvec m(operand(prhs[1], tmp, handle));
            plhs[0] = m.convert2mxArray();
            break;
-       
-       }       
-       
-       case 'g': {
+       }
+
+       case 'P': {
+           if(nrhs < 2) {
+               help();
+           }
+
+           mxMvec tmp;
+           bool handle = false;
+           mxMvec m(operand(prhs[1], tmp, handle));
+           plhs[0] = m.convert2Packed();
+           break;
+       }
+
+       /* R x ~R for a batch: the columns of a dim x N double matrix,
+          returned as a matrix, or the multivectors of a cell array,
+          returned as a cell array of handles */
+       case 'r': {
            if(nrhs < 3) {
                help();
            }
 
-           if(!mxIsClass(prhs[1],"mvec")) {
+           mxMvec tmpR;
+           bool handle = false;
+           const Mvec &R = operand(prhs[1], tmpR, handle);
+
+           if(mxIsCell(prhs[2])) {
+               mwSize N = mxGetNumberOfElements(prhs[2]);
+               std::vector<mxMvec> tmp(N);
+               std::vector<const Mvec*> x(N);
+               for(mwSize i=0;i<N;i++) {
+                   const mxArray *c = mxGetCell(prhs[2],i);
+                   if(!c) {
+                       mexErrMsgTxt("Failed to read mvec cell");
+                   }
+                   x[i] = &operand(c, tmp[i], handle);
+               }
+
+               std::vector<Mvec> y(N);
+               long n = (long) N;
+#ifdef OMP_ENABLED
+#pragma omp parallel for schedule(dynamic)
+#endif
+               for(long i=0;i<n;i++) {
+                   y[i] = Mvec::sandwich(R, *x[i]);
+               }
+
+               plhs[0] = mxCreateCellMatrix(mxGetM(prhs[2]), mxGetN(prhs[2]));
+               if(!plhs[0]) {
+                   mexErrMsgTxt("Failed to allocate memory for mvec cell!");
+               }
+               for(mwSize i=0;i<N;i++) {
+                   mxSetCell(plhs[0],i,mxHandles::insert(y[i]));
+               }
+           } else {
+               if(!mxIsClass(prhs[2],"double")) {
+                   mexErrMsgTxt("Batch rotation needs a dim x N double matrix or a cell!");
+               }
+               size_t dim = mxGetM(prhs[2]);
+               size_t N = mxGetN(prhs[2]);
+               if(dim == 0 || dim > bkey_t::maxDim) {
+                   mexErrMsgTxt("Batch rotation uses basis vectors beyond GCA_MAX_DIM!");
+               }
+               VersorMap map(R, (unsigned int) dim);
+
+               plhs[0] = mxCreateDoubleMatrix(dim, N, mxREAL);
+               if(!plhs[0]) {
+                   mexErrMsgTxt("Failed to allocate memory for mx matrix!");
+               }
+               map.apply(mxGetPr(prhs[2]), mxGetPr(plhs[0]), N);
+           }
+           break;
+       }
+
+       case 'x': {
+           for(int i=1;i<nrhs;i++) {
+               if(mxHandles::isHandle(prhs[i])) {
+                   mxHandles::erase(prhs[i]);
+               }
+           }
+           break;
+       }
+
+       case 'c': {
+           plhs[0] = mxCreateDoubleScalar((double) mxHandles::size());
+           break;
+       }
+
+       case 'g': {
+           if(nrhs < 3) {
                help();
            }
 
-           mxMvec a(prhs[1]);
+           mxMvec tmp;
+           bool handle = false;
+           const Mvec &a = operand(prhs[1], tmp, handle);
            double *grade = mxGetPr(prhs[2]);
-           
-           mxMvec b = a[(unsigned int) (*grade)];
-           plhs[0] = b.convert2mxArray();
+
+           plhs[0] = result(a[(unsigned int) (*grade)], handle);
            break;
        }
-       
-       case '&': 
+
+       case '&':
        case '^':
        case '*':
        case '+':
@@ -58,34 +188,37 @@ void mexFunction(int nlhs, mxArray *plhs[ ], int nrhs, const mxArray *prhs[]) {
            if(nrhs < 3) {
                help();
            }
-       
-           mxMvec a(prhs[1]);
-           mxMvec b(prhs[2]);
-           mxMvec c;
-           
+
+           mxMvec tmpA;
+           mxMvec tmpB;
+           bool handle = false;
+           const Mvec &a = operand(prhs[1], tmpA, handle);
+           const Mvec &b = operand(prhs[2], tmpB, handle);
+           Mvec c;
+
            switch(*cmd) {
-            case '&': 
+            case '&':
                 c = a&b;
                 break;
-                
+
             case '^':
                 c = a^b;
                 break;
-                
+
             case '*':
                 c = a*b;
                 break;
-                
+
             case '+':
                 c = a+b;
                 break;
-                
-            case '-': 
+
+            case '-':
                 c = a-b;
                 break;
            }
-           
-           plhs[0] = c.convert2mxArray();         
+
+           plhs[0] = result(c, handle);
            break;
        }
 
@@ -94,53 +227,45 @@ void mexFunction(int nlhs, mxArray *plhs[ ], int nrhs, const mxArray *prhs[]) {
            if(nrhs < 2) {
                help();
            }
-       
-           if(!mxIsClass(prhs[1],"mvec")) {
-               help();
-           }
-           
-           mxMvec a(prhs[1]);
-           mxMvec b = ~a;
-           plhs[0] = b.convert2mxArray();         
+
+           mxMvec tmp;
+           bool handle = false;
+           const Mvec &a = operand(prhs[1], tmp, handle);
+           plhs[0] = result(~a, handle);
            break;
-       }       
-       
+       }
+
        case 'v':
        {
            if(nrhs < 2) {
                help();
            }
-       
-           if(!mxIsClass(prhs[1],"mvec")) {
-               help();
-           }
-           
-           mxMvec a(prhs[1]);
+
+           mxMvec tmp;
+           bool handle = false;
+           mxMvec a(operand(prhs[1], tmp, handle));
            if(nrhs > 2) {
                 double *dim = mxGetPr(prhs[2]);
-                plhs[0] = a.matVec((unsigned int) *dim);                        
+                plhs[0] = a.matVec((unsigned int) *dim);
            } else {
-                plhs[0] = a.matVec();         
+                plhs[0] = a.matVec();
            }
-           
+
            break;
-       }  
+       }
        case 'p': {
            if(nrhs < 2) {
                help();
            }
 
-           if(!mxIsClass(prhs[1],"mvec") && 
-              !mxIsClass(prhs[1],"smvec")) {
-               help();
-           }
-           
-           mxMvec m(prhs[1]);
+           mxMvec tmp;
+           bool handle = false;
+           const Mvec &m = operand(prhs[1], tmp, handle);
            cout << m << endl;
            break;
-       }        
+       }
        default:
            mexErrMsgTxt("Unknown command");
    }
-   
+
 }
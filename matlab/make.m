@@ -1,5 +1,10 @@
 function make
 
-mex -output gcamvec -v -I../gca -I../src gcamvec.cpp mxMvec.cpp
+if(isunix && ~ismac)
+    % Batch commands run in parallel with OpenMP
+    mex -output gcamvec -v -I../gca -I../src CXXFLAGS='$CXXFLAGS -std=c++14 -fopenmp -DOMP_ENABLED' LDFLAGS='$LDFLAGS -fopenmp' gcamvec.cpp mxMvec.cpp
+else
+    mex -output gcamvec -v -I../gca -I../src CXXFLAGS='$CXXFLAGS -std=c++14' gcamvec.cpp mxMvec.cpp
+end
 
 end
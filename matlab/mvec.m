@@ -24,101 +24,138 @@ classdef mvec < handle
 %   a.grade(x) - returns a pure multi-vector with blades of grade x
 %   a.vec(dim) - converts multi-vector to vector of dimenison dim
 %   a.scalar - return scalar part of multi-vector
+%   R.apply(X) - returns R X ~R for every column of the dim x N matrix X,
+%              or for every mvec of the cell array X, in one call
+%   a.packed - returns the blades as a struct with a uint64 matrix
+%              'masks', one column of basis bitmask words per blade
+%              (e1 is bit 0 of the first word), and a double row 'v' of
+%              coefficients; mvec(p) reads this form back, as well as
+%              the cell array of a.gcamdata
+%
+%   The multi-vector itself is kept by gcamvec on the C++ side; an mvec
+%   only holds its handle, and results of operations stay there until
+%   vec, display or gcamdata asks for the values. The C++ object is
+%   freed when the last MATLAB reference to the mvec goes away.
 
    properties (Hidden)
 
    end
    % The following properties can be set only by class methods
    properties (SetAccess = private)
-      gcamdata=[];
+      h=uint64(0);
+   end
+   % Blades as a cell array of structs, converted on request
+   properties (Dependent)
+      gcamdata
    end
    methods
-      % Create a new multivector
+      % Create a new multivector; a uint64 argument is a handle returned
+      % by gcamvec
       function m = mvec(x)
          % If no arguments passed in, create a zero-scalara vector
          if(~exist('x','var'))
-             m.gcamdata = gcamvec('n',0);          
-         elseif(ischar(x))
-             m.gcamdata = gcamvec('n',x);
-         elseif(iscell(x))
-             m.gcamdata = x; 
+             m.h = gcamvec('N',0);          
+         elseif(isa(x,'uint64'))
+             m.h = x;
+         elseif(ischar(x) || iscell(x) || isstruct(x))
+             m.h = gcamvec('N',x);
          else
-             m.gcamdata = gcamvec('n',double(x));
+             m.h = gcamvec('N',double(x));
+         end
+      end
+
+      function delete(m)
+         if(m.h ~= 0)
+             gcamvec('x',m.h);
          end
-         % Calling a static method requires the class name
-         % addAccount registers the InsufficientFunds listener on this instance
+      end
+
+      function d = get.gcamdata(m)
+         d = gcamvec('d',m.h);
+      end
+
+      function Y = apply(R,X)
+         if(iscell(X))
+             X = cellfun(@mvecHandle,X,'UniformOutput',false);
+             Y = cellfun(@mvec,gcamvec('r',R.h,X),'UniformOutput',false);
+         else
+             Y = gcamvec('r',R.h,double(X));
+         end
+      end
+
+      function p = packed(m)
+         p = gcamvec('P',m.h);
       end
 
       function c = times(a,b)
-         c = mvec(gcamvec('&',a,b));
+         c = mvec(gcamvec('&',mvecHandle(a),mvecHandle(b)));
          %if(length(c.gcamdata)==1)
          %  c = blade(c.gcamdata{1});
          %end
       end
 
       function c = mpower(a,b)
-        c = mvec(gcamvec('^',a,b));
+        c = mvec(gcamvec('^',mvecHandle(a),mvecHandle(b)));
         %if(length(c.gcamdata)==1)
         %   c = blade(c.gcamdata{1});
         %end
       end
       
       function c = mtimes(a,b)
-        c = mvec(gcamvec('*',a,b));
+        c = mvec(gcamvec('*',mvecHandle(a),mvecHandle(b)));
         %if(length(c.gcamdata)==1)
         %   c = blade(c.gcamdata{1});
         %end
       end
       
       function c = not(m)
-         c = mvec(gcamvec('~',m));          
+         c = mvec(gcamvec('~',m.h));          
       end
 
       function display(m)
-        gcamvec('p',m);
+        gcamvec('p',m.h);
       end
       
       function c = vec(m,vargin)
          if(nargin==1)
-             c=gcamvec('v',m);
+             c=gcamvec('v',m.h);
          else
-             c=gcamvec('v',m,vargin);
+             c=gcamvec('v',m.h,vargin);
          end
       end
 
       function c = maxVal(m)
+         d = m.gcamdata;
          indx = 1;
-         for i=2:length(m.gcamdata)
-            if(m.gcamdata{i}.v > m.gcamdata{indx}.v)
+         for i=2:length(d)
+            if(d{i}.v > d{indx}.v)
                 indx = i;
             end
          end
-         c = blade(m.gcamdata{indx});
+         c = blade(d{indx});
       end
       
       function c = minVal(m)
+         d = m.gcamdata;
          indx = 1;
-         for i=2:length(m.gcamdata)
-            if(m.gcamdata{i}.v < m.gcamdata{indx}.v)
+         for i=2:length(d)
+            if(d{i}.v < d{indx}.v)
                 indx = i;
             end
          end
-         c = blade(m.gcamdata{indx});
+         c = blade(d{indx});
       end
       
       function c = uminus(m)
-         c = mvec(m.gcamdata);
-         for i=1:length(m.gcamdata)
-            c.gcamdata{i}.v = -c.gcamdata{i}.v; 
-         end          
+         c = mvec(gcamvec('*',m.h,-1));
       end
       
       function c = minus(a,b)
-         c = mvec(gcamvec('-',a,b));
+         c = mvec(gcamvec('-',mvecHandle(a),mvecHandle(b)));
       end
       
       function c = plus(a,b)
-         c = mvec(gcamvec('+',a,b));
+         c = mvec(gcamvec('+',mvecHandle(a),mvecHandle(b)));
       end
 
       function c = iszero(a)
@@ -130,15 +167,16 @@ classdef mvec < handle
       end
       
       function c = grade(a,g)
-        c = mvec(gcamvec('g',a,g));
+        c = mvec(gcamvec('g',a.h,g));
       end
              
       function c = scalar(a)
-        c = mvec(gcamvec('g',a,0));
-        if(isempty(c.gcamdata))
+        c = mvec(gcamvec('g',a.h,0));
+        d = c.gcamdata;
+        if(isempty(d))
             c = 0;
         else
-            c = c.gcamdata{1}.v;
+            c = d{1}.v;
         end
       end
       
@@ -155,4 +193,13 @@ classdef mvec < handle
       
       
    end % methods
-end % classdef
\ No newline at end of file
+end % classdef
+
+% Handle of an mvec operand; numbers are passed on as they are
+function h = mvecHandle(x)
+   if(isa(x,'mvec'))
+      h = x.h;
+   else
+      h = x;
+   end
+end
\ No newline at end of file
@@ -16,21 +16,28 @@ mxMvec::mxMvec() : Mvec() {
 mxMvec::mxMvec(const mxArray *a) {
 
     if(mxIsClass(a,"mvec")) {
-        mxArray *m = mxGetProperty(a,0,"gcamdata");
-        if(!m) {
+        mxArray *h = mxGetProperty(a,0,"h");
+        if(!h || !mxHandles::isHandle(h)) {
            mexErrMsgTxt("mvec format invalid!"); 
         }
-
-        mwSize nblades = mxGetNumberOfElements(m);     
+        _blades = mxHandles::get(h).blades();
+        mxDestroyArray(h);
+    } else if(mxHandles::isHandle(a)) {
+        _blades = mxHandles::get(a).blades();
+    } else if(mxIsStruct(a)) {
+        this->readPacked(a);
+    } else if(mxIsCell(a)) {
+        mwSize nblades = mxGetNumberOfElements(a);     
 
         for(unsigned int i=0;i<nblades;i++) {
-            mxArray *bmx = mxGetCell(m,i);
+            mxArray *bmx = mxGetCell(a,i);
             
             if(!bmx) {
                 mexErrMsgTxt("Failed to read mvec cell");
             }
             _blades.push_back(mxArray2Blade(bmx));
         }
+        this->sortBlades();
     } else {
         size_t N = mxGetN(a);
         size_t M = mxGetM(a);
@@ -40,6 +47,9 @@ mxMvec::mxMvec(const mxArray *a) {
         }
         
         size_t L = N*M;
+        if(L > bkey_t::maxDim) {
+            mexErrMsgTxt("mvec vector is longer than GCA_MAX_DIM!");
+        }
            
         double *v = mxGetPr(a);        
 
@@ -95,7 +105,7 @@ mxArray *mxMvec::Blade2mxArray(const Blade &b) {
     return smxB;
 }
 
-Blade& mxMvec::mxArray2Blade(const mxArray *B) {
+Blade mxMvec::mxArray2Blade(const mxArray *B) {
     mxArray *mxA = mxGetField(B, 0, "grade");
     if (!mxA || !mxIsClass(mxA,"double")) {
         mexErrMsgTxt("Failed to read field 'grade'!");
@@ -116,13 +126,16 @@ Blade& mxMvec::mxArray2Blade(const mxArray *B) {
     }
     unsigned int *e_p = (unsigned int *) mxGetData(mxA);
     
-    std::vector<unsigned long> e;
+    ebase_t e;
     
     for(std::size_t i=0;i<grade;i++) {
+        if(*e_p < 1 || *e_p > bkey_t::maxDim) {
+            mexErrMsgTxt("mvec uses basis vectors beyond GCA_MAX_DIM!");
+        }
         e.push_back(*e_p++);
     }
 
-    return *(new Blade(v,e));
+    return Blade(v,e);
 }
 
 mxArray *mxMvec::convert2mxArray(void) {
@@ -134,7 +147,7 @@ mxArray *mxMvec::convert2mxArray(void) {
         mexErrMsgTxt("Failed to allocate memory for mvec cell!");
     }
     
-    std::list<Blade>::iterator i;
+    blades_t::const_iterator i;
     mwIndex cindx=0;
     
     for(i=_blades.begin();i!=_blades.end();i++) {
@@ -144,6 +157,74 @@ mxArray *mxMvec::convert2mxArray(void) {
 }
 
 
+/* Packed form: a struct with a W x N uint64 field 'masks', column j
+ * holding the basis bitmask of blade j in words of 64 basis vectors,
+ * and a 1 x N double field 'v' with the coefficients. */
+mxArray *mxMvec::convert2Packed(void) {
+    const char *fieldNames[] = {"masks", "v"};
+    mwSize dims[2] = {1, 1};
+    mxArray *smxP = mxCreateStructArray(2, dims, 2, fieldNames);
+    if(!smxP) {
+        mexErrMsgTxt("Failed to create packed mvec!");
+    }
+    
+    std::size_t n = _blades.size();
+    unsigned long top = 0;
+    blades_t::const_iterator i;
+    for(i=_blades.begin();i!=_blades.end();i++) {
+        top = std::max(top, i->key().top());
+    }
+    unsigned int words = top > 64 ? (unsigned int) ((top + 63) / 64) : 1;
+    
+    mxArray *mxMasks = mxCreateNumericMatrix(words, n, mxUINT64_CLASS, mxREAL);
+    mxArray *mxV = mxCreateDoubleMatrix(1, n, mxREAL);
+    if(!mxMasks || !mxV) {
+        mexErrMsgTxt("Failed to allocate memory for packed mvec!");
+    }
+    
+    uint64_t *w = (uint64_t *) mxGetData(mxMasks);
+    double *v = mxGetPr(mxV);
+    for(i=_blades.begin();i!=_blades.end();i++) {
+        i->key().toWords(w, words);
+        w += words;
+        *v++ = i->get();
+    }
+    
+    mxSetFieldByNumber(smxP, 0, mxGetFieldNumber(smxP, "masks"), mxMasks);
+    mxSetFieldByNumber(smxP, 0, mxGetFieldNumber(smxP, "v"), mxV);
+    return smxP;
+}
+
+void mxMvec::readPacked(const mxArray *p) {
+    mxArray *mxMasks = mxGetField(p, 0, "masks");
+    mxArray *mxV = mxGetField(p, 0, "v");
+    if(!mxMasks || !mxIsUint64(mxMasks) || !mxV || !mxIsClass(mxV,"double")) {
+        mexErrMsgTxt("Packed mvec needs uint64 'masks' and double 'v' fields!");
+    }
+    
+    std::size_t n = mxGetNumberOfElements(mxV);
+    std::size_t words = mxGetM(mxMasks);
+    if(mxGetN(mxMasks) != n || (n > 0 && words == 0)) {
+        mexErrMsgTxt("Packed mvec needs one mask column per coefficient!");
+    }
+    
+    const uint64_t *w = (const uint64_t *) mxGetData(mxMasks);
+    const double *v = mxGetPr(mxV);
+    std::size_t maxWords = bkey_t::maxDim / 64 + (bkey_t::maxDim % 64 != 0);
+    _blades.clear();
+    _blades.reserve(n);
+    for(std::size_t j=0;j<n;j++) {
+        for(std::size_t k=maxWords;k<words;k++) {
+            if(w[k]) {
+                mexErrMsgTxt("Packed mvec uses basis vectors beyond GCA_MAX_DIM!");
+            }
+        }
+        _blades.push_back(Blade(v[j], bkey_t::fromWords(w, (unsigned int) words)));
+        w += words;
+    }
+    this->sortBlades();
+}
+
 mxArray *mxMvec::matVec() {
     blades_t::iterator i;
     unsigned int dim = 0;
@@ -178,3 +259,86 @@ mxArray *mxMvec::matVec(unsigned int dim){
     
     return mxV;
 }
+
+
+std::vector<mxHandles::Slot> mxHandles::_slots;
+std::vector<uint32_t> mxHandles::_free;
+std::size_t mxHandles::_live = 0;
+
+mxArray *mxHandles::insert(const Mvec &m) {
+    // m may live in a slot, which growing the table would move
+    Mvec c(m);
+    std::size_t k;
+    if(_free.empty()) {
+        k = _slots.size();
+        Slot s;
+        s.gen = 0;
+        s.used = false;
+        _slots.push_back(s);
+    } else {
+        k = _free.back();
+        _free.pop_back();
+    }
+    
+    Slot &s = _slots[k];
+    s.m = std::move(c);
+    s.gen++;
+    s.used = true;
+    if(_live++ == 0) {
+        mexLock();
+    }
+    
+    mxArray *h = mxCreateNumericMatrix(1, 1, mxUINT64_CLASS, mxREAL);
+    if(!h) {
+        mexErrMsgTxt("Failed to allocate memory for mvec handle!");
+    }
+    *(uint64_t *) mxGetData(h) = ((uint64_t) s.gen << 32) | (uint64_t) (k + 1);
+    return h;
+}
+
+bool mxHandles::isHandle(const mxArray *a) {
+    return mxIsUint64(a) && mxGetNumberOfElements(a) == 1;
+}
+
+const Mvec& mxHandles::get(const mxArray *a) {
+    return _slots[find(*(uint64_t *) mxGetData(a))].m;
+}
+
+void mxHandles::erase(const mxArray *a) {
+    uint64_t h = *(uint64_t *) mxGetData(a);
+    std::size_t k = (std::size_t) (h & 0xffffffffULL);
+    if(k == 0 || k > _slots.size() || !_slots[k - 1].used ||
+       _slots[k - 1].gen != (uint32_t) (h >> 32)) {
+        return;
+    }
+    k--;
+    _slots[k].m = Mvec();
+    _slots[k].used = false;
+    _free.push_back((uint32_t) k);
+    if(--_live == 0) {
+        mexUnlock();
+    }
+}
+
+void mxHandles::clear() {
+    if(_live > 0) {
+        mexUnlock();
+    }
+    _slots.clear();
+    _free.clear();
+    _live = 0;
+}
+
+std::size_t mxHandles::size() {
+    return _live;
+}
+
+std::size_t mxHandles::find(uint64_t h) {
+    std::size_t k = (std::size_t) (h & 0xffffffffULL);
+    uint32_t gen = (uint32_t) (h >> 32);
+    if(k == 0 || k > _slots.size() || !_slots[k - 1].used ||
+       _slots[k - 1].gen != gen) {
+        mexErrMsgTxt("Invalid mvec handle!");
+    }
+    return k - 1;
+}
@@ -10,6 +10,8 @@
 
 #include "mex.h"
 #include <Mvec>
+#include <vector>
+#include <stdint.h>
 
 class mxMvec : public gca::Mvec {
 public:
@@ -19,14 +21,53 @@ public:
     mxMvec(const mxArray *m);
     mxMvec(const Mvec& orig);
     mxArray* convert2mxArray(void);
+    mxArray* convert2Packed(void);
     mxArray* matVec();
     mxArray* matVec(unsigned int dim);         
 
 private:
     static mxArray* Blade2mxArray(const gca::Blade &b);
-    static gca::Blade&   mxArray2Blade(const mxArray *mxb);
+    static gca::Blade    mxArray2Blade(const mxArray *mxb);
+    void readPacked(const mxArray *p);
     
 };
 
+/* Multivectors kept on the C++ side between MEX calls. MATLAB holds a
+ * uint64 handle, made of the slot index and a generation count so that
+ * a stale handle to a reused slot is rejected. The MEX file is locked
+ * in memory while any handle is alive. */
+class mxHandles {
+public:
+    /* Store m and return its handle as a uint64 scalar */
+    static mxArray* insert(const gca::Mvec &m);
+    
+    /* True if a is a uint64 scalar, the form of a handle */
+    static bool isHandle(const mxArray *a);
+    
+    /* Multivector of a handle; an invalid handle is a MATLAB error */
+    static const gca::Mvec& get(const mxArray *a);
+    
+    /* Free the multivector of a handle; unknown handles are ignored, as
+       after the table was cleared when the MEX file was unloaded */
+    static void erase(const mxArray *a);
+    
+    static void clear();
+    
+    static std::size_t size();
+
+private:
+    struct Slot {
+        gca::Mvec m;
+        uint32_t gen;
+        bool used;
+    };
+    
+    static std::size_t find(uint64_t h);
+    
+    static std::vector<Slot> _slots;
+    static std::vector<uint32_t> _free;
+    static std::size_t _live;
+};
+
 #endif	/* MXMvec_H */
 
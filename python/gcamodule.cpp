@@ -0,0 +1,1010 @@
+/*
+ * File:   gcamodule.cpp
+ *
+ * Python module gca over gca::Mvec, for batches of multivectors held in
+ * NumPy arrays (or any object exporting the buffer protocol). Inputs are
+ * read in place, without copies, and must be C-contiguous. Two layouts
+ * are understood:
+ *
+ *    dense   float64 array of shape (N, 2^n), or (2^n,) for a single
+ *            multivector; column k holds the blade whose basis bitmask
+ *            is k (bit i-1 set for e_i), as in DenseMvec
+ *
+ *    sparse  tuple (masks, coefs, offsets) of a uint64 array of basis
+ *            bitmasks, a float64 array of coefficients of the same
+ *            length, and an int64 array of N+1 offsets: multivector r
+ *            holds entries offsets[r] .. offsets[r+1]-1. Bitmasks cover
+ *            e1..e64, one entry per blade.
+ *
+ * Dense products, sums and differences of up to GCA_PY_MAX_KERNEL
+ * basis vectors run on the table-driven kernels of DenseMvec, with all
+ * 2^n coefficients kept, so they are not pruned to GCA_PRECISION as the
+ * Mvec results are. Wider rows, and sandwich, which assumes a versor,
+ * go through a sparse Mvec per row.
+ *
+ * Results are gca.Array objects owning their memory and exporting it
+ * through the buffer protocol, so numpy.asarray(result) is a view, not a
+ * copy. Binary operations broadcast a single multivector against a
+ * batch. The GIL is released while the kernels run, and with OMP_ENABLED
+ * the rows of a batch are spread over threads.
+ *
+ * The functions follow the commands of matlab/gcamvec.cpp:
+ *
+ *    mul, inner, outer, add, sub     (a, b)       dense
+ *    reverse (a), grade (a, k), sandwich (R, x)   dense
+ *    apply (R, X)         R x ~R for the rows of an (N, d) vector array
+ *    to_vectors (a, d), from_vectors (X, n)       dense <-> (N, d)
+ *    sparse_mul, sparse_inner, sparse_outer, sparse_add, sparse_sub,
+ *    sparse_reverse, sparse_grade, sparse_sandwich  on sparse tuples
+ *    to_dense (A, n), to_sparse (a)               layout conversions
+ *    format (a)           text of a dense row or of a sparse tuple row 0
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <Mvec>
+#include <Batch>
+#include <DenseMvec>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <new>
+#include <string.h>
+
+using namespace gca;
+
+/* Largest dimension of the dense layout, 2^GCA_PY_MAX_DENSE columns */
+#ifndef GCA_PY_MAX_DENSE
+#define GCA_PY_MAX_DENSE  16
+#endif
+
+static_assert(GCA_PY_MAX_DENSE < 63 && GCA_PY_MAX_DENSE <= GCA_MAX_DIM,
+        "GCA_PY_MAX_DENSE must fit the bitmasks of dense columns");
+
+/* Largest dimension of the dense rows handled by DenseMvec */
+#ifndef GCA_PY_MAX_KERNEL
+#define GCA_PY_MAX_KERNEL  6
+#endif
+
+static_assert(GCA_PY_MAX_KERNEL <= 6, "denseKernel covers dimensions up to 6");
+
+enum {
+    OP_MUL, OP_INNER, OP_OUTER, OP_ADD, OP_SUB, OP_SANDWICH
+};
+
+/* ---- gca.Array: result buffer owned by Python ---- */
+
+typedef struct {
+    PyObject_HEAD
+    char *data;
+    int ndim;
+    Py_ssize_t itemsize;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+    char format[2];
+} ArrayObject;
+
+static void Array_dealloc(ArrayObject *a) {
+    PyMem_RawFree(a->data);
+    Py_TYPE(a)->tp_free((PyObject*) a);
+}
+
+static Py_ssize_t Array_bytes(const ArrayObject *a) {
+    Py_ssize_t n = a->itemsize;
+    for (int k = 0; k < a->ndim; k++) {
+        n *= a->shape[k];
+    }
+    return n;
+}
+
+static int Array_getbuffer(PyObject *obj, Py_buffer *view, int flags) {
+    ArrayObject *a = (ArrayObject*) obj;
+    view->obj = obj;
+    Py_INCREF(obj);
+    view->buf = a->data;
+    view->len = Array_bytes(a);
+    view->readonly = 0;
+    view->itemsize = a->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? a->format : NULL;
+    view->ndim = a->ndim;
+    view->shape = ((flags & PyBUF_ND) == PyBUF_ND) ? a->shape : NULL;
+    view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? a->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static PyObject* Array_shape(ArrayObject *a, void*) {
+    PyObject *t = PyTuple_New(a->ndim);
+    for (int k = 0; t && k < a->ndim; k++) {
+        PyTuple_SET_ITEM(t, k, PyLong_FromSsize_t(a->shape[k]));
+    }
+    return t;
+}
+
+static Py_ssize_t Array_len(ArrayObject *a) {
+    return a->shape[0];
+}
+
+static PyBufferProcs Array_buffer = {
+    Array_getbuffer, NULL
+};
+
+static PySequenceMethods Array_sequence = {
+    (lenfunc) Array_len
+};
+
+static PyGetSetDef Array_getset[] = {
+    {"shape", (getter) Array_shape, NULL, "Shape of the array", NULL},
+    {NULL}
+};
+
+static PyTypeObject ArrayType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "gca.Array"
+};
+
+/* Zeroed array of rows x cols items of type fmt ('d' or 'q' or 'Q'),
+   one-dimensional when ndim is 1 */
+static ArrayObject* newArray(char fmt, Py_ssize_t rows, Py_ssize_t cols, int ndim) {
+    ArrayObject *a = PyObject_New(ArrayObject, &ArrayType);
+    if (!a) {
+        return NULL;
+    }
+    a->itemsize = 8;
+    a->ndim = ndim;
+    a->format[0] = fmt;
+    a->format[1] = 0;
+    if (ndim == 1) {
+        a->shape[0] = rows * cols;
+        a->shape[1] = 1;
+        a->strides[0] = a->itemsize;
+        a->strides[1] = a->itemsize;
+    } else {
+        a->shape[0] = rows;
+        a->shape[1] = cols;
+        a->strides[0] = cols * a->itemsize;
+        a->strides[1] = a->itemsize;
+    }
+    a->data = (char*) PyMem_RawCalloc(rows * cols > 0 ? rows * cols : 1, a->itemsize);
+    if (!a->data) {
+        Py_DECREF(a);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return a;
+}
+
+/* ---- Inputs read in place ---- */
+
+class Input {
+public:
+
+    Input() : _ok(false) {
+    }
+
+    ~Input() {
+        if (_ok) {
+            PyBuffer_Release(&_v);
+        }
+    }
+
+    /* Borrow the contiguous buffer of o, of doubles for kind 'd' or of
+       64-bit integers for kind 'i' */
+    bool get(PyObject *o, char kind, const char *name) {
+        if (PyObject_GetBuffer(o, &_v, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) < 0) {
+            return false;
+        }
+        _ok = true;
+
+        const char *f = _v.format ? _v.format : "B";
+        if (*f == '@' || *f == '=' || *f == '<') {
+            f++;
+        }
+        bool fits = kind == 'd' ? strcmp(f, "d") == 0
+                : (strlen(f) == 1 && strchr("qQlL", *f) && _v.itemsize == 8);
+        if (!fits || _v.ndim > 2) {
+            PyErr_Format(PyExc_TypeError, "%s must be a contiguous %s array of at most 2 dimensions",
+                    name, kind == 'd' ? "float64" : "64-bit integer");
+            return false;
+        }
+        return true;
+    }
+
+    int ndim() const {
+        return _v.ndim;
+    }
+
+    Py_ssize_t size() const {
+        return _v.len / _v.itemsize;
+    }
+
+    /* A one-dimensional array is a single row */
+    Py_ssize_t rows() const {
+        return _v.ndim == 2 ? _v.shape[0] : 1;
+    }
+
+    Py_ssize_t cols() const {
+        return _v.ndim == 2 ? _v.shape[1] : (_v.ndim == 1 ? _v.shape[0] : 1);
+    }
+
+    const double* d() const {
+        return (const double*) _v.buf;
+    }
+
+    const uint64_t* u() const {
+        return (const uint64_t*) _v.buf;
+    }
+
+    const int64_t* i() const {
+        return (const int64_t*) _v.buf;
+    }
+
+private:
+
+    Input(const Input&);
+    Input& operator=(const Input&);
+
+    Py_buffer _v;
+    bool _ok;
+};
+
+/* Dense rows: columns must be 2^n, n at most GCA_PY_MAX_DENSE */
+static bool denseInput(Input &in, PyObject *o, const char *name) {
+    if (!in.get(o, 'd', name)) {
+        return false;
+    }
+    Py_ssize_t c = in.cols();
+    if (c < 1 || (c & (c - 1)) || c > ((Py_ssize_t) 1 << GCA_PY_MAX_DENSE)) {
+        PyErr_Format(PyExc_ValueError, "%s needs 2^n coefficients per row, n <= %d",
+                name, GCA_PY_MAX_DENSE);
+        return false;
+    }
+    return true;
+}
+
+class SparseInput {
+public:
+
+    bool get(PyObject *o, const char *name) {
+        PyObject *m, *c, *f;
+        if (!PyTuple_Check(o) || !PyArg_ParseTuple(o, "OOO", &m, &c, &f)) {
+            PyErr_Format(PyExc_TypeError, "%s must be a tuple (masks, coefs, offsets)", name);
+            return false;
+        }
+        if (!_masks.get(m, 'i', "masks") || !_coefs.get(c, 'd', "coefs")
+                || !_offsets.get(f, 'i', "offsets")) {
+            return false;
+        }
+        if (_masks.size() != _coefs.size() || _offsets.size() < 1) {
+            PyErr_Format(PyExc_ValueError, "%s: masks and coefs differ in length or offsets is empty", name);
+            return false;
+        }
+        const int64_t *off = _offsets.i();
+        Py_ssize_t n = _offsets.size();
+        if (off[0] != 0 || off[n - 1] != (int64_t) _masks.size()) {
+            PyErr_Format(PyExc_ValueError, "%s: offsets must run from 0 to the number of entries", name);
+            return false;
+        }
+        for (Py_ssize_t r = 1; r < n; r++) {
+            if (off[r] < off[r - 1]) {
+                PyErr_Format(PyExc_ValueError, "%s: offsets must not decrease", name);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Py_ssize_t rows() const {
+        return _offsets.size() - 1;
+    }
+
+    Mvec row(Py_ssize_t r) const {
+        const int64_t *off = _offsets.i();
+        blades_t b;
+        for (int64_t k = off[r]; k < off[r + 1]; k++) {
+            if (_coefs.d()[k] != 0) {
+                b.push_back(Blade(_coefs.d()[k], bkey_t::fromBits(_masks.u()[k])));
+            }
+        }
+        return Mvec(b);
+    }
+
+private:
+
+    Input _masks;
+    Input _coefs;
+    Input _offsets;
+};
+
+/* ---- Kernels ---- */
+
+static Mvec fromDense(const double *c, Py_ssize_t n) {
+    blades_t b;
+    for (Py_ssize_t k = 0; k < n; k++) {
+        if (c[k] != 0) {
+            b.push_back(Blade(c[k], bkey_t::fromBits((uint64_t) k)));
+        }
+    }
+    return Mvec(b);
+}
+
+/* Blades outside the 2^n columns are dropped */
+static void toDense(const Mvec &m, double *c, Py_ssize_t n) {
+    blades_t::const_iterator b;
+    for (b = m.blades().begin(); b != m.blades().end(); b++) {
+        if (b->key().narrow() && b->key().bits() < (uint64_t) n) {
+            c[b->key().bits()] = b->get();
+        }
+    }
+}
+
+static Mvec binary(int op, const Mvec &a, const Mvec &b) {
+    switch (op) {
+        case OP_MUL:
+            return a.mul(b);
+        case OP_INNER:
+            return a.inner(b);
+        case OP_OUTER:
+            return a.outer(b);
+        case OP_ADD:
+            return a.add(b);
+        case OP_SUB:
+            return a.sub(b);
+        default:
+            return Mvec::sandwich(a, b);
+    }
+}
+
+/* First exception thrown by a kernel while the GIL is released, kept
+   to be raised as a Python exception once the GIL is held again.
+   Exceptions must not leave an OpenMP region, so rows catch their own. */
+class KernelError {
+public:
+
+    KernelError() : _type(0) {
+    }
+
+    template<class F>
+    void run(F f) {
+        try {
+            f();
+        } catch (const std::out_of_range &e) {
+            this->set(PyExc_ValueError, e.what());
+        } catch (const std::bad_alloc&) {
+            this->set(PyExc_MemoryError, "out of memory");
+        } catch (const std::exception &e) {
+            this->set(PyExc_RuntimeError, e.what());
+        } catch (...) {
+            this->set(PyExc_RuntimeError, "unknown error in a gca kernel");
+        }
+    }
+
+    /* Set the Python exception if a kernel failed; needs the GIL */
+    bool raise() const {
+        if (!_type) {
+            return false;
+        }
+        PyErr_SetString(_type, _what.c_str());
+        return true;
+    }
+
+private:
+
+    void set(PyObject *type, const char *what) {
+#ifdef OMP_ENABLED
+#pragma omp critical(gcaKernelError)
+#endif
+        {
+            if (!_type) {
+                _type = type;
+                _what = what;
+            }
+        }
+    }
+
+    PyObject *_type;
+    std::string _what;
+};
+
+template<class F>
+static void forRows(Py_ssize_t n, KernelError &err, F f) {
+    long np = (long) n;
+#ifdef OMP_ENABLED
+#pragma omp parallel for schedule(dynamic, 16) if (np > 16)
+#endif
+    for (long r = 0; r < np; r++) {
+        err.run([&] {
+            f(r);
+        });
+    }
+}
+
+/* Rows of a batch of na against one of nb, one of them possibly single */
+static bool broadcast(Py_ssize_t na, Py_ssize_t nb, Py_ssize_t &n) {
+    if (na != nb && na != 1 && nb != 1) {
+        PyErr_Format(PyExc_ValueError, "operands have %zd and %zd rows", na, nb);
+        return false;
+    }
+    n = na == 1 ? nb : na;
+    return true;
+}
+
+/* Build the sparse tuple of a list of multivectors */
+static PyObject* sparseResult(const std::vector<Mvec> &m) {
+    Py_ssize_t n = (Py_ssize_t) m.size();
+    Py_ssize_t total = 0;
+    for (Py_ssize_t r = 0; r < n; r++) {
+        total += (Py_ssize_t) m[r].blades().size();
+    }
+    ArrayObject *masks = newArray('Q', total, 1, 1);
+    ArrayObject *coefs = newArray('d', total, 1, 1);
+    ArrayObject *offsets = newArray('q', n + 1, 1, 1);
+    if (!masks || !coefs || !offsets) {
+        Py_XDECREF(masks);
+        Py_XDECREF(coefs);
+        Py_XDECREF(offsets);
+        return NULL;
+    }
+
+    uint64_t *mk = (uint64_t*) masks->data;
+    double *cf = (double*) coefs->data;
+    int64_t *off = (int64_t*) offsets->data;
+    KernelError err;
+    Py_BEGIN_ALLOW_THREADS
+    for (Py_ssize_t r = 0; r < n; r++) {
+        off[r + 1] = off[r] + (int64_t) m[r].blades().size();
+    }
+    forRows(n, err, [&](long r) {
+        int64_t k = off[r];
+        blades_t::const_iterator b;
+        for (b = m[r].blades().begin(); b != m[r].blades().end(); b++, k++) {
+            mk[k] = b->key().bits();
+            cf[k] = b->get();
+        }
+    });
+    Py_END_ALLOW_THREADS
+    if (err.raise()) {
+        Py_DECREF(masks);
+        Py_DECREF(coefs);
+        Py_DECREF(offsets);
+        return NULL;
+    }
+
+    return Py_BuildValue("(NNN)", masks, coefs, offsets);
+}
+
+/* Rows of dimension N through DenseMvec; a row stride of 0 repeats
+   the single multivector of a broadcast operand */
+template<unsigned int N>
+static void denseRows(int op, const double *a, Py_ssize_t sa,
+        const double *b, Py_ssize_t sb, double *y, Py_ssize_t n,
+        KernelError &err) {
+    const std::size_t bytes = DenseMvec<N>::size * sizeof (double);
+    forRows(n, err, [&](long r) {
+        DenseMvec<N> x;
+        DenseMvec<N> z;
+        memcpy(x.data(), a + r * sa, bytes);
+        memcpy(z.data(), b + r * sb, bytes);
+        DenseMvec<N> m;
+        switch (op) {
+            case OP_MUL:
+                m = x.mul(z);
+                break;
+            case OP_INNER:
+                m = x.inner(z);
+                break;
+            case OP_OUTER:
+                m = x.outer(z);
+                break;
+            case OP_ADD:
+                m = x + z;
+                break;
+            default:
+                m = x - z;
+                break;
+        }
+        memcpy(y + r * DenseMvec<N>::size, m.data(), bytes);
+    });
+}
+
+/* False if op on rows of c columns has no DenseMvec kernel */
+static bool denseKernel(int op, Py_ssize_t c, const double *a, Py_ssize_t sa,
+        const double *b, Py_ssize_t sb, double *y, Py_ssize_t n,
+        KernelError &err) {
+    if (op == OP_SANDWICH) {
+        return false;
+    }
+    switch (c) {
+        case 1:
+            denseRows<0>(op, a, sa, b, sb, y, n, err);
+            return true;
+        case 2:
+            denseRows<1>(op, a, sa, b, sb, y, n, err);
+            return true;
+        case 4:
+            denseRows<2>(op, a, sa, b, sb, y, n, err);
+            return true;
+        case 8:
+            denseRows<3>(op, a, sa, b, sb, y, n, err);
+            return true;
+        case 16:
+            denseRows<4>(op, a, sa, b, sb, y, n, err);
+            return true;
+        case 32:
+            denseRows<5>(op, a, sa, b, sb, y, n, err);
+            return true;
+        case 64:
+            denseRows<6>(op, a, sa, b, sb, y, n, err);
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* ---- Dense functions ---- */
+
+static PyObject* denseBinary(PyObject *args, int op) {
+    PyObject *oa, *ob;
+    if (!PyArg_ParseTuple(args, "OO", &oa, &ob)) {
+        return NULL;
+    }
+    Input a, b;
+    if (!denseInput(a, oa, "a") || !denseInput(b, ob, "b")) {
+        return NULL;
+    }
+    if (a.cols() != b.cols()) {
+        PyErr_SetString(PyExc_ValueError, "operands differ in dimension");
+        return NULL;
+    }
+    Py_ssize_t n;
+    if (!broadcast(a.rows(), b.rows(), n)) {
+        return NULL;
+    }
+
+    Py_ssize_t c = a.cols();
+    ArrayObject *out = newArray('d', n, c, (a.ndim() == 2 || b.ndim() == 2) ? 2 : 1);
+    if (!out) {
+        return NULL;
+    }
+    double *y = (double*) out->data;
+    Py_ssize_t sa = a.rows() == 1 ? 0 : c;
+    Py_ssize_t sb = b.rows() == 1 ? 0 : c;
+    KernelError err;
+    Py_BEGIN_ALLOW_THREADS
+    if (c > ((Py_ssize_t) 1 << GCA_PY_MAX_KERNEL) ||
+        !denseKernel(op, c, a.d(), sa, b.d(), sb, y, n, err)) {
+        forRows(n, err, [&](long r) {
+            Mvec m = binary(op, fromDense(a.d() + r * sa, c), fromDense(b.d() + r * sb, c));
+            toDense(m, y + r * c, c);
+        });
+    }
+    Py_END_ALLOW_THREADS
+    if (err.raise()) {
+        Py_DECREF(out);
+        return NULL;
+    }
+    return (PyObject*) out;
+}
+
+static PyObject* py_mul(PyObject*, PyObject *args) {
+    return denseBinary(args, OP_MUL);
+}
+
+static PyObject* py_inner(PyObject*, PyObject *args) {
+    return denseBinary(args, OP_INNER);
+}
+
+static PyObject* py_outer(PyObject*, PyObject *args) {
+    return denseBinary(args, OP_OUTER);
+}
+
+static PyObject* py_add(PyObject*, PyObject *args) {
+    return denseBinary(args, OP_ADD);
+}
+
+static PyObject* py_sub(PyObject*, PyObject *args) {
+    return denseBinary(args, OP_SUB);
+}
+
+static PyObject* py_sandwich(PyObject*, PyObject *args) {
+    return denseBinary(args, OP_SANDWICH);
+}
+
+/* Reverse (grade < 0) or grade projection of dense rows. Both only
+   change or drop coefficients in place, so no Mvec is needed. */
+static PyObject* denseUnary(PyObject *oa, int grade) {
+    Input a;
+    if (!denseInput(a, oa, "a")) {
+        return NULL;
+    }
+    Py_ssize_t n = a.rows();
+    Py_ssize_t c = a.cols();
+    ArrayObject *out = newArray('d', n, c, a.ndim() == 2 ? 2 : 1);
+    if (!out) {
+        return NULL;
+    }
+    double *y = (double*) out->data;
+    KernelError err;
+    Py_BEGIN_ALLOW_THREADS
+    err.run([&] {
+        std::vector<double> f(c);
+        for (Py_ssize_t k = 0; k < c; k++) {
+            int g = bkey_t::fromBits((uint64_t) k).grade();
+            if (grade < 0) {
+                f[k] = ((g * (g - 1) / 2) % 2) ? -1 : 1;
+            } else {
+                f[k] = g == grade ? 1 : 0;
+            }
+        }
+        forRows(n, err, [&](long r) {
+            const double *x = a.d() + r * c;
+            for (Py_ssize_t k = 0; k < c; k++) {
+                y[r * c + k] = f[k] * x[k];
+            }
+        });
+    });
+    Py_END_ALLOW_THREADS
+    if (err.raise()) {
+        Py_DECREF(out);
+        return NULL;
+    }
+    return (PyObject*) out;
+}
+
+static PyObject* py_reverse(PyObject*, PyObject *args) {
+    PyObject *oa;
+    if (!PyArg_ParseTuple(args, "O", &oa)) {
+        return NULL;
+    }
+    return denseUnary(oa, -1);
+}
+
+static PyObject* py_grade(PyObject*, PyObject *args) {
+    PyObject *oa;
+    unsigned int k;
+    if (!PyArg_ParseTuple(args, "OI", &oa, &k)) {
+        return NULL;
+    }
+    return denseUnary(oa, (int) k);
+}
+
+/* R x ~R for the rows of an (N, d) array of vectors of e1..ed */
+static PyObject* py_apply(PyObject*, PyObject *args) {
+    PyObject *oR, *ox;
+    if (!PyArg_ParseTuple(args, "OO", &oR, &ox)) {
+        return NULL;
+    }
+    Input R, x;
+    if (!denseInput(R, oR, "R") || !x.get(ox, 'd', "X")) {
+        return NULL;
+    }
+    if (R.rows() != 1) {
+        PyErr_SetString(PyExc_ValueError, "R must be a single multivector");
+        return NULL;
+    }
+    Py_ssize_t d = x.cols();
+    if (d < 1 || (unsigned long) d > (unsigned long) bkey_t::maxDim) {
+        PyErr_Format(PyExc_ValueError, "X rows need 1 to %lu coordinates",
+                (unsigned long) bkey_t::maxDim);
+        return NULL;
+    }
+    ArrayObject *out = newArray('d', x.rows(), d, x.ndim() == 2 ? 2 : 1);
+    if (!out) {
+        return NULL;
+    }
+    KernelError err;
+    Py_BEGIN_ALLOW_THREADS
+    err.run([&] {
+        VersorMap map(fromDense(R.d(), R.cols()), (unsigned int) d);
+        map.apply(x.d(), (double*) out->data, x.rows());
+    });
+    Py_END_ALLOW_THREADS
+    if (err.raise()) {
+        Py_DECREF(out);
+        return NULL;
+    }
+    return (PyObject*) out;
+}
+
+static PyObject* py_to_vectors(PyObject*, PyObject *args) {
+    PyObject *oa;
+    unsigned int d;
+    if (!PyArg_ParseTuple(args, "OI", &oa, &d)) {
+        return NULL;
+    }
+    Input a;
+    if (!denseInput(a, oa, "a")) {
+        return NULL;
+    }
+    if (d > GCA_PY_MAX_DENSE || ((Py_ssize_t) 1 << d) > a.cols()) {
+        PyErr_SetString(PyExc_ValueError, "dimension larger than the one of the rows");
+        return NULL;
+    }
+    Py_ssize_t n = a.rows();
+    Py_ssize_t c = a.cols();
+    ArrayObject *out = newArray('d', n, d, a.ndim() == 2 ? 2 : 1);
+    if (!out) {
+        return NULL;
+    }
+    double *y = (double*) out->data;
+    KernelError err;
+    Py_BEGIN_ALLOW_THREADS
+    forRows(n, err, [&](long r) {
+        for (unsigned int i = 0; i < d; i++) {
+            y[r * d + i] = a.d()[r * c + ((Py_ssize_t) 1 << i)];
+        }
+    });
+    Py_END_ALLOW_THREADS
+    if (err.raise()) {
+        Py_DECREF(out);
+        return NULL;
+    }
+    return (PyObject*) out;
+}
+
+static PyObject* py_from_vectors(PyObject*, PyObject *args) {
+    PyObject *ox;
+    unsigned int dim = 0;
+    if (!PyArg_ParseTuple(args, "O|I", &ox, &dim)) {
+        return NULL;
+    }
+    Input x;
+    if (!x.get(ox, 'd', "X")) {
+        return NULL;
+    }
+    Py_ssize_t d = x.cols();
+    if (dim < d) {
+        dim = (unsigned int) d;
+    }
+    if (dim > GCA_PY_MAX_DENSE) {
+        PyErr_Format(PyExc_ValueError, "dense layout limited to dimension %d", GCA_PY_MAX_DENSE);
+        return NULL;
+    }
+    Py_ssize_t n = x.rows();
+    Py_ssize_t c = (Py_ssize_t) 1 << dim;
+    ArrayObject *out = newArray('d', n, c, x.ndim() == 2 ? 2 : 1);
+    if (!out) {
+        return NULL;
+    }
+    double *y = (double*) out->data;
+    KernelError err;
+    Py_BEGIN_ALLOW_THREADS
+    forRows(n, err, [&](long r) {
+        for (Py_ssize_t i = 0; i < d; i++) {
+            y[r * c + ((Py_ssize_t) 1 << i)] = x.d()[r * d + i];
+        }
+    });
+    Py_END_ALLOW_THREADS
+    if (err.raise()) {
+        Py_DECREF(out);
+        return NULL;
+    }
+    return (PyObject*) out;
+}
+
+/* ---- Sparse functions ---- */
+
+static PyObject* sparseBinary(PyObject *args, int op) {
+    PyObject *oa, *ob;
+    if (!PyArg_ParseTuple(args, "OO", &oa, &ob)) {
+        return NULL;
+    }
+    SparseInput a, b;
+    if (!a.get(oa, "a") || !b.get(ob, "b")) {
+        return NULL;
+    }
+    Py_ssize_t n;
+    if (!broadcast(a.rows(), b.rows(), n)) {
+        return NULL;
+    }
+
+    std::vector<Mvec> y(n);
+    KernelError err;
+    Py_BEGIN_ALLOW_THREADS
+    bool oneA = a.rows() == 1;
+    bool oneB = b.rows() == 1;
+    forRows(n, err, [&](long r) {
+        y[r] = binary(op, a.row(oneA ? 0 : r), b.row(oneB ? 0 : r));
+    });
+    Py_END_ALLOW_THREADS
+    if (err.raise()) {
+        return NULL;
+    }
+    return sparseResult(y);
+}
+
+static PyObject* py_sparse_mul(PyObject*, PyObject *args) {
+    return sparseBinary(args, OP_MUL);
+}
+
+static PyObject* py_sparse_inner(PyObject*, PyObject *args) {
+    return sparseBinary(args, OP_INNER);
+}
+
+static PyObject* py_sparse_outer(PyObject*, PyObject *args) {
+    return sparseBinary(args, OP_OUTER);
+}
+
+static PyObject* py_sparse_add(PyObject*, PyObject *args) {
+    return sparseBinary(args, OP_ADD);
+}
+
+static PyObject* py_sparse_sub(PyObject*, PyObject *args) {
+    return sparseBinary(args, OP_SUB);
+}
+
+static PyObject* py_sparse_sandwich(PyObject*, PyObject *args) {
+    return sparseBinary(args, OP_SANDWICH);
+}
+
+static PyObject* sparseUnary(PyObject *oa, int grade) {
+    SparseInput a;
+    if (!a.get(oa, "a")) {
+        return NULL;
+    }
+    std::vector<Mvec> y(a.rows());
+    KernelError err;
+    Py_BEGIN_ALLOW_THREADS
+    forRows(a.rows(), err, [&](long r) {
+        y[r] = grade < 0 ? ~a.row(r) : a.row(r)[(unsigned int) grade];
+    });
+    Py_END_ALLOW_THREADS
+    if (err.raise()) {
+        return NULL;
+    }
+    return sparseResult(y);
+}
+
+static PyObject* py_sparse_reverse(PyObject*, PyObject *args) {
+    PyObject *oa;
+    if (!PyArg_ParseTuple(args, "O", &oa)) {
+        return NULL;
+    }
+    return sparseUnary(oa, -1);
+}
+
+static PyObject* py_sparse_grade(PyObject*, PyObject *args) {
+    PyObject *oa;
+    unsigned int k;
+    if (!PyArg_ParseTuple(args, "OI", &oa, &k)) {
+        return NULL;
+    }
+    return sparseUnary(oa, (int) k);
+}
+
+static PyObject* py_to_dense(PyObject*, PyObject *args) {
+    PyObject *oa;
+    unsigned int dim;
+    if (!PyArg_ParseTuple(args, "OI", &oa, &dim)) {
+        return NULL;
+    }
+    SparseInput a;
+    if (!a.get(oa, "a")) {
+        return NULL;
+    }
+    if (dim > GCA_PY_MAX_DENSE) {
+        PyErr_Format(PyExc_ValueError, "dense layout limited to dimension %d", GCA_PY_MAX_DENSE);
+        return NULL;
+    }
+    Py_ssize_t c = (Py_ssize_t) 1 << dim;
+    ArrayObject *out = newArray('d', a.rows(), c, 2);
+    if (!out) {
+        return NULL;
+    }
+    double *y = (double*) out->data;
+    KernelError err;
+    Py_BEGIN_ALLOW_THREADS
+    forRows(a.rows(), err, [&](long r) {
+        toDense(a.row(r), y + r * c, c);
+    });
+    Py_END_ALLOW_THREADS
+    if (err.raise()) {
+        Py_DECREF(out);
+        return NULL;
+    }
+    return (PyObject*) out;
+}
+
+static PyObject* py_to_sparse(PyObject*, PyObject *args) {
+    PyObject *oa;
+    if (!PyArg_ParseTuple(args, "O", &oa)) {
+        return NULL;
+    }
+    Input a;
+    if (!denseInput(a, oa, "a")) {
+        return NULL;
+    }
+    std::vector<Mvec> y(a.rows());
+    KernelError err;
+    Py_BEGIN_ALLOW_THREADS
+    forRows(a.rows(), err, [&](long r) {
+        y[r] = fromDense(a.d() + r * a.cols(), a.cols());
+    });
+    Py_END_ALLOW_THREADS
+    if (err.raise()) {
+        return NULL;
+    }
+    return sparseResult(y);
+}
+
+static PyObject* py_format(PyObject*, PyObject *args) {
+    PyObject *oa;
+    if (!PyArg_ParseTuple(args, "O", &oa)) {
+        return NULL;
+    }
+    Mvec m;
+    if (PyTuple_Check(oa)) {
+        SparseInput a;
+        if (!a.get(oa, "a")) {
+            return NULL;
+        }
+        if (a.rows() > 0) {
+            m = a.row(0);
+        }
+    } else {
+        Input a;
+        if (!denseInput(a, oa, "a")) {
+            return NULL;
+        }
+        m = fromDense(a.d(), a.cols());
+    }
+    return PyUnicode_FromString(m.toString().c_str());
+}
+
+static PyMethodDef methods[] = {
+    {"mul", py_mul, METH_VARARGS, "mul(a, b): geometric products of dense rows"},
+    {"inner", py_inner, METH_VARARGS, "inner(a, b): inner products of dense rows"},
+    {"outer", py_outer, METH_VARARGS, "outer(a, b): outer products of dense rows"},
+    {"add", py_add, METH_VARARGS, "add(a, b): sums of dense rows"},
+    {"sub", py_sub, METH_VARARGS, "sub(a, b): differences of dense rows"},
+    {"sandwich", py_sandwich, METH_VARARGS, "sandwich(R, x): R x ~R for dense rows"},
+    {"reverse", py_reverse, METH_VARARGS, "reverse(a): reverses of dense rows"},
+    {"grade", py_grade, METH_VARARGS, "grade(a, k): grade k parts of dense rows"},
+    {"apply", py_apply, METH_VARARGS, "apply(R, X): R x ~R for the rows of an (N, d) vector array"},
+    {"to_vectors", py_to_vectors, METH_VARARGS, "to_vectors(a, d): e1..ed coefficients of dense rows"},
+    {"from_vectors", py_from_vectors, METH_VARARGS, "from_vectors(X, n=d): dense rows of dimension n from (N, d) vectors"},
+    {"sparse_mul", py_sparse_mul, METH_VARARGS, "sparse_mul(a, b): geometric products of sparse rows"},
+    {"sparse_inner", py_sparse_inner, METH_VARARGS, "sparse_inner(a, b): inner products of sparse rows"},
+    {"sparse_outer", py_sparse_outer, METH_VARARGS, "sparse_outer(a, b): outer products of sparse rows"},
+    {"sparse_add", py_sparse_add, METH_VARARGS, "sparse_add(a, b): sums of sparse rows"},
+    {"sparse_sub", py_sparse_sub, METH_VARARGS, "sparse_sub(a, b): differences of sparse rows"},
+    {"sparse_sandwich", py_sparse_sandwich, METH_VARARGS, "sparse_sandwich(R, x): R x ~R for sparse rows"},
+    {"sparse_reverse", py_sparse_reverse, METH_VARARGS, "sparse_reverse(a): reverses of sparse rows"},
+    {"sparse_grade", py_sparse_grade, METH_VARARGS, "sparse_grade(a, k): grade k parts of sparse rows"},
+    {"to_dense", py_to_dense, METH_VARARGS, "to_dense(a, n): dense rows of dimension n from sparse rows"},
+    {"to_sparse", py_to_sparse, METH_VARARGS, "to_sparse(a): sparse rows from dense rows"},
+    {"format", py_format, METH_VARARGS, "format(a): text of the first multivector of a"},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef module = {
+    PyModuleDef_HEAD_INIT, "gca",
+    "Batched multivector products over buffer-protocol arrays", -1, methods
+};
+
+PyMODINIT_FUNC PyInit_gca(void) {
+    ArrayType.tp_basicsize = sizeof (ArrayObject);
+    ArrayType.tp_dealloc = (destructor) Array_dealloc;
+    ArrayType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ArrayType.tp_doc = "Result array, exported through the buffer protocol";
+    ArrayType.tp_as_buffer = &Array_buffer;
+    ArrayType.tp_as_sequence = &Array_sequence;
+    ArrayType.tp_getset = Array_getset;
+    if (PyType_Ready(&ArrayType) < 0) {
+        return NULL;
+    }
+
+    PyObject *m = PyModule_Create(&module);
+    if (!m) {
+        return NULL;
+    }
+    Py_INCREF(&ArrayType);
+    if (PyModule_AddObject(m, "Array", (PyObject*) &ArrayType) < 0) {
+        Py_DECREF(&ArrayType);
+        Py_DECREF(m);
+        return NULL;
+    }
+    return m;
+}
@@ -0,0 +1,19 @@
+# Build with: python setup.py build_ext --inplace
+import sys
+from setuptools import setup, Extension
+
+args = ['-std=c++14', '-O3']
+link = []
+if sys.platform.startswith('linux'):
+    # Batches are spread over threads with OpenMP
+    args += ['-fopenmp', '-DOMP_ENABLED']
+    link += ['-fopenmp']
+
+setup(name='gca',
+      version='0.1',
+      description='Batched multivector products over buffer-protocol arrays',
+      ext_modules=[Extension('gca', ['gcamodule.cpp'],
+                             include_dirs=['../gca', '../src'],
+                             extra_compile_args=args,
+                             extra_link_args=link,
+                             language='c++')])
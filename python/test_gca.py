@@ -0,0 +1,133 @@
+# Checks of the gca module with the standard library only: arrays from
+# the array module are shaped through memoryview, as numpy arrays are.
+# Run after python setup.py build_ext --inplace.
+
+import math
+import random
+import threading
+import time
+from array import array
+
+import gca
+
+
+def shaped(values, cols, code='d'):
+    m = memoryview(array(code, values)).cast('B')
+    return m.cast(code, [len(values) // cols, cols])
+
+
+def rows(a):
+    return memoryview(a).tolist()
+
+
+def maxdiff(a, b):
+    fa = [x for r in a for x in r] if isinstance(a[0], list) else a
+    fb = [x for r in b for x in r] if isinstance(b[0], list) else b
+    return max(abs(x - y) for x, y in zip(fa, fb))
+
+
+def rotor(dim):
+    # exp of a random bivector e_i e_j, a unit rotor
+    R = [0.0] * (1 << dim)
+    i, j = random.sample(range(dim), 2)
+    t = random.uniform(-math.pi, math.pi)
+    R[0] = math.cos(t / 2)
+    R[(1 << i) | (1 << j)] = math.sin(t / 2) * (1 if i < j else -1)
+    return array('d', R)
+
+
+random.seed(1)
+dim = 4
+C = 1 << dim
+N = 2000
+
+print("# Testing dense products against sparse ones")
+A = shaped([random.uniform(-1, 1) for _ in range(N * C)], C)
+B = shaped([random.uniform(-1, 1) for _ in range(N * C)], C)
+t = time.process_time()
+D = gca.mul(A, B)
+print("Dense time taken", time.process_time() - t, "s.")
+t = time.process_time()
+S = gca.sparse_mul(gca.to_sparse(A), gca.to_sparse(B))
+print("Sparse time taken", time.process_time() - t, "s.")
+print("----")
+diff = maxdiff(rows(D), rows(gca.to_dense(S, dim)))
+print("Max difference", diff)
+assert diff < 1e-12
+assert memoryview(D).shape == (N, C) and D.shape == (N, C)
+
+for name in ("inner", "outer", "add", "sub", "sandwich"):
+    d = getattr(gca, name)(A, B)
+    s = gca.to_dense(getattr(gca, "sparse_" + name)(gca.to_sparse(A), gca.to_sparse(B)), dim)
+    assert maxdiff(rows(d), rows(s)) < 1e-12, name
+
+print("# Testing grade and reverse")
+G = [gca.grade(A, k) for k in range(dim + 1)]
+total = [[sum(rows(g)[r][c] for g in G) for c in range(C)] for r in range(3)]
+assert maxdiff(total, rows(A)[:3]) < 1e-15
+rev = rows(gca.reverse(A))
+srev = rows(gca.to_dense(gca.sparse_reverse(gca.to_sparse(A)), dim))
+assert maxdiff(rev, srev) < 1e-15
+sg = rows(gca.to_dense(gca.sparse_grade(gca.to_sparse(A), 2), dim))
+assert maxdiff(sg, rows(G[2])) < 1e-15
+
+print("# Testing broadcasting and vector conversion")
+R = rotor(dim)
+X = shaped([random.uniform(-1, 1) for _ in range(N * dim)], dim)
+t = time.process_time()
+Y = gca.apply(R, X)
+print("Apply time taken", time.process_time() - t, "s.")
+Z = gca.to_vectors(gca.sandwich(R, gca.from_vectors(X, dim)), dim)
+diff = maxdiff(rows(Y), rows(Z))
+print("Max difference", diff)
+assert diff < 1e-12
+V = rows(gca.to_vectors(gca.from_vectors(X), dim))
+assert V == rows(X)
+assert len(gca.mul(R, R)) == C and gca.format(R).strip() != ""
+
+print("# Testing sparse input checks")
+masks = memoryview(array('Q', [0, 1, 2]))
+coefs = memoryview(array('d', [1.0, 2.0, 3.0]))
+for bad in [(masks, coefs, array('q', [0, 2])),
+            (masks, coefs, array('q', [0, 3, 1, 3])),
+            (masks, array('d', [1.0]), array('q', [0, 3]))]:
+    try:
+        gca.sparse_add(bad, bad)
+        raise AssertionError("bad offsets accepted")
+    except ValueError:
+        pass
+try:
+    gca.mul(array('d', [1.0, 2.0, 3.0]), array('d', [1.0, 2.0, 3.0]))
+    raise AssertionError("3 columns accepted")
+except ValueError:
+    pass
+for d in (dim + 1, 64, 1000):
+    try:
+        gca.to_vectors(A, d)
+        raise AssertionError("dimension %d accepted" % d)
+    except ValueError:
+        pass
+try:
+    gca.apply(R, shaped([0.0] * 1000, 1000))
+    raise AssertionError("1000 coordinates accepted by apply")
+except ValueError:
+    pass
+try:
+    gca.mul(array('f', [1.0, 2.0]), array('f', [1.0, 2.0]))
+    raise AssertionError("float32 accepted")
+except TypeError:
+    pass
+
+print("# Testing threads running while the kernels hold no GIL")
+big = shaped([random.uniform(-1, 1) for _ in range(20000 * C)], C)
+out = []
+threads = [threading.Thread(target=lambda: out.append(gca.mul(big, big))) for _ in range(4)]
+t = time.time()
+for th in threads:
+    th.start()
+for th in threads:
+    th.join()
+print("Threads time taken", time.time() - t, "s.")
+assert all(rows(o) == rows(out[0]) for o in out)
+print("----")
+print("All checks passed")
@@ -0,0 +1,122 @@
+/*
+ * File:   Accum.h
+ *
+ * Keyed blade accumulator for sparse products. Contributions are summed
+ * into an open-addressing table on the blade key as they are computed,
+ * so a product only ever holds one blade per distinct output key. The
+ * table and the blade storage keep their capacity across clear(), and
+ * clear() only touches the slots in use.
+ */
+
+#ifndef ACCUM_H
+#define	ACCUM_H
+
+#include "Blade.h"
+#include <vector>
+#include <algorithm>
+
+namespace gca {
+
+   class Accum {
+   public:
+
+      Accum() : _mask(0) {
+      }
+
+      void clear() {
+         for (std::size_t k = 0; k < _slot.size(); k++) {
+            _table[_slot[k]] = -1;
+         }
+         _blades.clear();
+         _slot.clear();
+      }
+
+      std::size_t size() const {
+         return _blades.size();
+      }
+
+      /* Accumulated blades, in the order their keys were first seen */
+      const std::vector<Blade>& blades() const {
+         return _blades;
+      }
+
+      /* Add v to the blade with key e; the first contribution to a key
+         starts its sum, so values are summed in the order they are added */
+      void add(const bkey_t &e, double v) {
+         if (2 * (_blades.size() + 1) > _table.size()) {
+            this->grow();
+         }
+         std::size_t s = e.hash() & _mask;
+         while (_table[s] >= 0) {
+            Blade &b = _blades[_table[s]];
+            if (b.key() == e) {
+               b.set(b.get() + v);
+               return;
+            }
+            s = (s + 1) & _mask;
+         }
+         _table[s] = (int) _blades.size();
+         _slot.push_back(s);
+         _blades.push_back(Blade(v, e));
+      }
+
+      /* Accumulated blade with key e, 0 if there is none */
+      const Blade* find(const bkey_t &e) const {
+         if (_table.empty()) {
+            return 0;
+         }
+         std::size_t s = e.hash() & _mask;
+         while (_table[s] >= 0) {
+            const Blade &b = _blades[_table[s]];
+            if (b.key() == e) {
+               return &b;
+            }
+            s = (s + 1) & _mask;
+         }
+         return 0;
+      }
+
+      /* Append the sum in canonical order to out. With dropZeros, blades
+         within precision of zero are left out and an empty sum becomes
+         the zero scalar. */
+      void finish(blades_t &out, bool dropZeros, double precision) {
+         std::sort(_blades.begin(), _blades.end());
+         std::size_t n = out.size();
+         out.reserve(n + _blades.size());
+         std::vector<Blade>::const_iterator i;
+         for (i = _blades.begin(); i != _blades.end(); i++) {
+            if (!dropZeros || i->get() > precision || i->get() < -precision) {
+               out.push_back(*i);
+            }
+         }
+         if (dropZeros && out.size() == n) {
+            out.push_back(Blade(0));
+         }
+         this->clear();
+      }
+
+   private:
+
+      void grow() {
+         std::size_t cap = _table.empty() ? 64 : 2 * _table.size();
+         _table.assign(cap, -1);
+         _mask = cap - 1;
+         for (std::size_t k = 0; k < _blades.size(); k++) {
+            std::size_t s = _blades[k].key().hash() & _mask;
+            while (_table[s] >= 0) {
+               s = (s + 1) & _mask;
+            }
+            _table[s] = (int) k;
+            _slot[k] = s;
+         }
+      }
+
+      std::vector<Blade> _blades;
+      std::vector<std::size_t> _slot;
+      std::vector<int> _table;
+      std::size_t _mask;
+   };
+
+}
+
+#endif	/* ACCUM_H */
@@ -0,0 +1,321 @@
+/*
+ * File:   Algebra.h
+ *
+ * Fixed-dimension algebra types. Algebra<N>::Element<G> holds the
+ * coefficients of every blade whose grade is in the grade set G (bit g
+ * set for grade g), in canonical Mvec order. The blade layouts and the
+ * product tables (sign, source and target index of every contributing
+ * pair) are generated at compile time from the Bmask sign rule, so a
+ * product between two known layouts expands into straight-line code.
+ *
+ * The tables grow as 4^N; the types are meant for N up to 5 or 6.
+ */
+
+#ifndef ALGEBRA_H
+#define	ALGEBRA_H
+
+#include "Mvec.h"
+#include <utility>
+
+namespace gca {
+
+   template<unsigned int N>
+   class Algebra {
+   public:
+
+      static const unsigned int dim = N;
+      static const unsigned int size = 1u << N;
+
+      struct Layout {
+         unsigned int count;
+         unsigned int mask[size];
+         int index[size];
+      };
+
+      /* Canonical blade order, as Bmask::operator< */
+      static constexpr bool before(unsigned int a, unsigned int b) {
+         return popcount64(a) != popcount64(b) ?
+                 popcount64(a) < popcount64(b) :
+                 (a & (a ^ b) & (~(a ^ b) + 1)) != 0;
+      }
+
+      static constexpr bool contributes(unsigned int a, unsigned int b,
+              int kind) {
+         return kind == PROD_MUL ||
+                 (kind == PROD_INNER ?
+                 (a == 0 || b == 0 || (a & b) != 0) :
+                 (a != 0 && b != 0 && (a & b) == 0));
+      }
+
+      /* Blades of the grade set in canonical order, and the position of
+         every blade mask in that order (-1 if not part of the layout) */
+      static constexpr Layout layout(unsigned int grades) {
+         Layout l = {};
+         for (unsigned int m = 0; m < size; m++) {
+            l.index[m] = -1;
+            if ((grades >> popcount64(m)) & 1) {
+               unsigned int k = l.count++;
+               while (k > 0 && before(m, l.mask[k - 1])) {
+                  l.mask[k] = l.mask[k - 1];
+                  k--;
+               }
+               l.mask[k] = m;
+            }
+         }
+         for (unsigned int k = 0; k < l.count; k++) {
+            l.index[l.mask[k]] = k;
+         }
+         return l;
+      }
+
+      static constexpr unsigned int productGrades(unsigned int gA,
+              unsigned int gB, int kind) {
+         Layout lA = layout(gA);
+         Layout lB = layout(gB);
+         unsigned int g = 0;
+         for (unsigned int i = 0; i < lA.count; i++) {
+            for (unsigned int j = 0; j < lB.count; j++) {
+               if (contributes(lA.mask[i], lB.mask[j], kind)) {
+                  g |= 1u << popcount64(lA.mask[i] ^ lB.mask[j]);
+               }
+            }
+         }
+         return g;
+      }
+
+      static const unsigned int allGrades = (1u << (N + 1)) - 1;
+      static const unsigned int evenGrades = 0x55555555u & allGrades;
+
+      template<unsigned int GA, unsigned int GB, int Kind>
+      struct Product;
+
+      template<unsigned int G>
+      class Element {
+      public:
+
+         static const unsigned int grades = G;
+         static constexpr Layout lay = layout(G);
+         static constexpr unsigned int count = lay.count;
+
+         Element() {
+            for (unsigned int k = 0; k < count; k++) {
+               _c[k] = 0;
+            }
+         }
+
+         /* Scalar, dropped if the layout has no grade 0 */
+         Element(double v) {
+            for (unsigned int k = 0; k < count; k++) {
+               _c[k] = 0;
+            }
+            if (G & 1) {
+               _c[0] = v;
+            }
+         }
+
+         /* Blades outside the layout are dropped */
+         explicit Element(const Mvec &m) {
+            for (unsigned int k = 0; k < count; k++) {
+               _c[k] = 0;
+            }
+            blades_t::const_iterator i;
+            for (i = m.blades().begin(); i != m.blades().end(); i++) {
+               uint64_t e = i->key().bits();
+               if (i->key().narrow() && e < size && lay.index[e] >= 0) {
+                  _c[lay.index[e]] += i->get();
+               }
+            }
+         }
+
+         /* Projection onto this layout */
+         template<unsigned int H>
+         explicit Element(const Element<H> &m) {
+            for (unsigned int k = 0; k < count; k++) {
+               int i = Element<H>::lay.index[lay.mask[k]];
+               _c[k] = (i >= 0) ? m.get(i) : 0;
+            }
+         }
+
+         Mvec toMvec() const {
+            blades_t blades;
+            for (unsigned int k = 0; k < count; k++) {
+               if (_c[k] > GCA_PRECISION || _c[k] < (-GCA_PRECISION)) {
+                  blades.push_back(Blade(_c[k], bkey_t::fromBits(lay.mask[k])));
+               }
+            }
+            if (blades.empty()) {
+               return Mvec(0.0);
+            }
+            return Mvec(blades);
+         }
+
+         /* Coefficient of the k-th blade of the layout */
+         double get(unsigned int k) const {
+            return _c[k];
+         }
+
+         void set(unsigned int k, double v) {
+            _c[k] = v;
+         }
+
+         /* Coefficient of the blade with basis mask e */
+         double coef(unsigned int e) const {
+            return lay.index[e] >= 0 ? _c[lay.index[e]] : 0;
+         }
+
+         const double* data() const {
+            return _c;
+         }
+
+         double* data() {
+            return _c;
+         }
+
+         template<unsigned int H>
+         typename Product<G, H, PROD_MUL>::result_t
+         operator*(const Element<H> &m) const {
+            typename Product<G, H, PROD_MUL>::result_t result;
+            Product<G, H, PROD_MUL>::apply(_c, m.data(), result.data());
+            return result;
+         }
+
+         template<unsigned int H>
+         typename Product<G, H, PROD_INNER>::result_t
+         operator&(const Element<H> &m) const {
+            typename Product<G, H, PROD_INNER>::result_t result;
+            Product<G, H, PROD_INNER>::apply(_c, m.data(), result.data());
+            return result;
+         }
+
+         template<unsigned int H>
+         typename Product<G, H, PROD_OUTER>::result_t
+         operator^(const Element<H> &m) const {
+            typename Product<G, H, PROD_OUTER>::result_t result;
+            Product<G, H, PROD_OUTER>::apply(_c, m.data(), result.data());
+            return result;
+         }
+
+         Element operator*(double x) const {
+            Element result;
+            for (unsigned int k = 0; k < count; k++) {
+               result._c[k] = _c[k] * x;
+            }
+            return result;
+         }
+
+         Element operator+(const Element &m) const {
+            Element result;
+            for (unsigned int k = 0; k < count; k++) {
+               result._c[k] = _c[k] + m._c[k];
+            }
+            return result;
+         }
+
+         Element operator-(const Element &m) const {
+            Element result;
+            for (unsigned int k = 0; k < count; k++) {
+               result._c[k] = _c[k] - m._c[k];
+            }
+            return result;
+         }
+
+         Element operator~(void) const {
+            Element result;
+            for (unsigned int k = 0; k < count; k++) {
+               unsigned int g = popcount64(lay.mask[k]);
+               result._c[k] = ((g * (g - 1) / 2) % 2 == 1) ? -_c[k] : _c[k];
+            }
+            return result;
+         }
+
+         friend std::ostream& operator<<(std::ostream &out, const Element &m) {
+            out << m.toMvec();
+            return out;
+         }
+
+      private:
+         double _c[count > 0 ? count : 1];
+      };
+
+      /* Contributing pairs of a product between two layouts */
+      template<unsigned int GA, unsigned int GB, int Kind>
+      struct Product {
+
+         typedef Element<productGrades(GA, GB, Kind)> result_t;
+
+         struct Table {
+            unsigned int count;
+            unsigned int a[size * size];
+            unsigned int b[size * size];
+            unsigned int c[size * size];
+            double s[size * size];
+         };
+
+         static constexpr Table make() {
+            Layout lA = layout(GA);
+            Layout lB = layout(GB);
+            Layout lC = layout(productGrades(GA, GB, Kind));
+            Table t = {};
+            for (unsigned int i = 0; i < lA.count; i++) {
+               for (unsigned int j = 0; j < lB.count; j++) {
+                  unsigned int eA = lA.mask[i];
+                  unsigned int eB = lB.mask[j];
+                  if (contributes(eA, eB, Kind)) {
+                     t.a[t.count] = i;
+                     t.b[t.count] = j;
+                     t.c[t.count] = lC.index[eA ^ eB];
+                     t.s[t.count] = sign64(eA, eB);
+                     t.count++;
+                  }
+               }
+            }
+            return t;
+         }
+
+         static constexpr Table table = make();
+
+         static void apply(const double *a, const double *b, double *c) {
+            for (unsigned int k = 0; k < result_t::count; k++) {
+               c[k] = 0;
+            }
+            run(a, b, c, std::make_index_sequence<table.count>());
+         }
+
+      private:
+
+         template<std::size_t... P>
+         static void run(const double *a, const double *b, double *c,
+                 std::index_sequence<P...>) {
+            int expand[] = {0, (term<P>(a, b, c), 0)...};
+            (void) expand;
+         }
+
+         template<std::size_t P>
+         static void term(const double *a, const double *b, double *c) {
+            constexpr unsigned int iA = table.a[P];
+            constexpr unsigned int iB = table.b[P];
+            constexpr unsigned int iC = table.c[P];
+            constexpr double s = table.s[P];
+            c[iC] += s * a[iA] * b[iB];
+         }
+      };
+
+      typedef Element<1u << 0> Scalar;
+      typedef Element<1u << 1> Vector;
+      typedef Element<1u << 2> Bivector;
+      typedef Element<evenGrades> Rotor;
+      typedef Element<allGrades> Multivector;
+   };
+
+   template<unsigned int N>
+   template<unsigned int G>
+   constexpr typename Algebra<N>::Layout Algebra<N>::Element<G>::lay;
+
+   template<unsigned int N>
+   template<unsigned int GA, unsigned int GB, int Kind>
+   constexpr typename Algebra<N>::template Product<GA, GB, Kind>::Table
+   Algebra<N>::Product<GA, GB, Kind>::table;
+
+}
+
+#endif	/* ALGEBRA_H */
@@ -0,0 +1,257 @@
+/*
+ * File:   Arena.h
+ *
+ * Scoped arena for the blade and basis lists of temporaries. While a
+ * gca::Arena is alive, allocations made through gca::Allocator on its
+ * thread are bump-allocated from the arena's chunks:
+ *
+ *    {
+ *       gca::Arena scope;
+ *       for (...) {
+ *          Mvec c = a * b + d;
+ *          ...
+ *       }
+ *    }   // chunks released here
+ *
+ * Each chunk counts its live blocks, plus one reference held by the
+ * arena. A chunk whose blocks have all been freed is reused from the
+ * start, so a loop of temporaries runs in a fixed amount of memory. At
+ * the end of the scope, the chunks with no live blocks are released at
+ * once. A multivector that outlives the scope keeps its chunk alive
+ * until it is destroyed, so returning results from a scope is safe.
+ *
+ * Outside any arena, gca::Allocator falls back to the heap. Arenas nest
+ * per thread, the innermost one being used. Blocks may be freed on any
+ * thread.
+ *
+ * With GCA_ALLOC_STATS, every thread counts its allocations and the time
+ * spent in them, see allocStats().
+ */
+
+#ifndef ARENA_H
+#define	ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#ifdef GCA_ALLOC_STATS
+#include <chrono>
+#endif
+
+/* Size of the chunks of an arena; blocks larger than a quarter of it go
+   straight to the heap */
+#ifndef GCA_ARENA_CHUNK
+#define GCA_ARENA_CHUNK  (64 * 1024)
+#endif
+
+namespace gca {
+
+   /* Per-thread allocation counters, only updated with GCA_ALLOC_STATS */
+   struct AllocStats {
+      unsigned long allocs;
+      unsigned long arenaAllocs;
+      unsigned long frees;
+      unsigned long bytes;
+      double secs;
+
+      AllocStats() {
+         this->clear();
+      }
+
+      void clear() {
+         allocs = 0;
+         arenaAllocs = 0;
+         frees = 0;
+         bytes = 0;
+         secs = 0;
+      }
+   };
+
+   inline AllocStats& allocStats() {
+      static thread_local AllocStats s;
+      return s;
+   }
+
+   class Arena {
+   public:
+
+      explicit Arena(std::size_t chunkSize = GCA_ARENA_CHUNK)
+      : _outer(Arena::top()), _cur(0), _chunkSize(chunkSize) {
+         Arena::top() = this;
+      }
+
+      ~Arena() {
+         Arena::top() = _outer;
+         for (std::size_t k = 0; k < _chunks.size(); k++) {
+            Arena::release(_chunks[k]);
+         }
+      }
+
+      /* Innermost arena of this thread, 0 if there is none */
+      static Arena* current() {
+         return Arena::top();
+      }
+
+      /* Block of n bytes from the current arena, or from the heap */
+      static void* allocate(std::size_t n) {
+#ifdef GCA_ALLOC_STATS
+         Timer t;
+         allocStats().allocs++;
+         allocStats().bytes += n;
+#endif
+         std::size_t need = HEADER + ((n + ALIGN - 1) & ~(ALIGN - 1));
+         Arena *a = Arena::top();
+         char *p;
+         if (a && need <= a->_chunkSize / 4) {
+#ifdef GCA_ALLOC_STATS
+            allocStats().arenaAllocs++;
+#endif
+            p = a->bump(need);
+         } else {
+            p = static_cast<char*> (::operator new(need));
+            *reinterpret_cast<Chunk**> (p) = 0;
+         }
+         return p + HEADER;
+      }
+
+      static void deallocate(void *ptr) {
+         if (!ptr) {
+            return;
+         }
+#ifdef GCA_ALLOC_STATS
+         Timer t;
+         allocStats().frees++;
+#endif
+         char *p = static_cast<char*> (ptr) - HEADER;
+         Chunk *c = *reinterpret_cast<Chunk**> (p);
+         if (c) {
+            Arena::release(c);
+         } else {
+            ::operator delete(p);
+         }
+      }
+
+   private:
+
+      Arena(const Arena&);
+      Arena& operator=(const Arena&);
+
+      enum {
+         ALIGN = 16, HEADER = 16
+      };
+
+      struct Chunk {
+         std::atomic<std::size_t> refs;
+         std::size_t used;
+         std::size_t size;
+      };
+
+#ifdef GCA_ALLOC_STATS
+
+      struct Timer {
+         std::chrono::steady_clock::time_point begin;
+
+         Timer() : begin(std::chrono::steady_clock::now()) {
+         }
+
+         ~Timer() {
+            allocStats().secs += std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - begin).count();
+         }
+      };
+#endif
+
+      static Arena*& top() {
+         static thread_local Arena *a = 0;
+         return a;
+      }
+
+      static std::size_t start() {
+         return (sizeof (Chunk) + ALIGN - 1) & ~(std::size_t) (ALIGN - 1);
+      }
+
+      static void release(Chunk *c) {
+         if (c->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            c->~Chunk();
+            ::operator delete(c);
+         }
+      }
+
+      /* A chunk holding only the arena's reference has no live blocks
+         and can be reused from the start */
+      static bool idle(Chunk *c) {
+         return c->refs.load(std::memory_order_acquire) == 1;
+      }
+
+      char* bump(std::size_t need) {
+         if (_cur && Arena::idle(_cur)) {
+            _cur->used = Arena::start();
+         }
+         if (!_cur || _cur->used + need > _cur->size) {
+            _cur = this->fresh();
+         }
+         char *p = reinterpret_cast<char*> (_cur) + _cur->used;
+         _cur->used += need;
+         _cur->refs.fetch_add(1, std::memory_order_relaxed);
+         *reinterpret_cast<Chunk**> (p) = _cur;
+         return p;
+      }
+
+      Chunk* fresh() {
+         for (std::size_t k = 0; k < _chunks.size(); k++) {
+            if (_chunks[k] != _cur && Arena::idle(_chunks[k])) {
+               _chunks[k]->used = Arena::start();
+               return _chunks[k];
+            }
+         }
+         Chunk *c = new (::operator new(_chunkSize)) Chunk;
+         c->refs.store(1, std::memory_order_relaxed);
+         c->used = Arena::start();
+         c->size = _chunkSize;
+         _chunks.push_back(c);
+         return c;
+      }
+
+      Arena *_outer;
+      Chunk *_cur;
+      std::size_t _chunkSize;
+      std::vector<Chunk*> _chunks;
+   };
+
+   /* Standard allocator drawing from the current thread's arena, if any */
+   template<class T>
+   struct Allocator {
+      typedef T value_type;
+
+      Allocator() {
+      }
+
+      template<class U>
+      Allocator(const Allocator<U>&) {
+      }
+
+      T* allocate(std::size_t n) {
+         static_assert(alignof(T) <= 16, "gca::Allocator aligns to 16 bytes");
+         return static_cast<T*> (Arena::allocate(n * sizeof (T)));
+      }
+
+      void deallocate(T *p, std::size_t) {
+         Arena::deallocate(p);
+      }
+   };
+
+   template<class T, class U>
+   bool operator==(const Allocator<T>&, const Allocator<U>&) {
+      return true;
+   }
+
+   template<class T, class U>
+   bool operator!=(const Allocator<T>&, const Allocator<U>&) {
+      return false;
+   }
+
+}
+
+#endif	/* ARENA_H */
@@ -0,0 +1,168 @@
+/*
+ * File:   Batch.h
+ *
+ * Batched versor sandwich for point clouds. R x ~R is linear in the
+ * vector x, so the sandwich is evaluated once per basis vector to build
+ * an n x n matrix and every point then costs a small matrix-vector
+ * product instead of two sparse products.
+ *
+ * Points are stored contiguously, n coordinates per point (the layout
+ * of a column-major n x N matrix such as Eigen's default).
+ */
+
+#ifndef BATCH_H
+#define	BATCH_H
+
+#include "Mvec.h"
+
+namespace gca {
+
+   class VersorMap {
+   public:
+
+      /* Map x -> R x ~R restricted to vectors of e1..en; the part of the
+         result outside grade 1 of e1..en is dropped */
+      VersorMap(const Mvec &R, unsigned int n) : _n(n), _m(n * n, 0) {
+         Mvec Rc = ~R;
+         for (unsigned int j = 0; j < n; j++) {
+            Mvec c = R * Mvec(1, j + 1) * Rc;
+            blades_t::const_iterator b;
+            for (b = c.blades().begin(); b != c.blades().end(); b++) {
+               unsigned long e = b->at(0);
+               if (b->grade() == 1 && e <= n) {
+                  _m[(e - 1) * n + j] = b->get();
+               }
+            }
+         }
+      }
+
+      unsigned int dim() const {
+         return _n;
+      }
+
+      /* Row-major matrix entry (i, j), both starting at 0 */
+      double at(unsigned int i, unsigned int j) const {
+         return _m[i * _n + j];
+      }
+
+      Mvec apply(const Mvec &x) const {
+         std::vector<double> v(_n, 0);
+         std::vector<double> w(_n);
+         blades_t::const_iterator b;
+         for (b = x.blades().begin(); b != x.blades().end(); b++) {
+            if (b->grade() == 1 && b->at(0) <= _n) {
+               v[b->at(0) - 1] = b->get();
+            }
+         }
+         this->apply(&v[0], &w[0], 1);
+
+         blades_t blades;
+         for (unsigned int i = 0; i < _n; i++) {
+            if (w[i] > GCA_PRECISION || w[i] < (-GCA_PRECISION)) {
+               blades.push_back(Blade(w[i], i + 1));
+            }
+         }
+         if (blades.empty()) {
+            return Mvec(0.0);
+         }
+         return Mvec(blades);
+      }
+
+      /* Transform count points of x into y; y may be x */
+      void apply(const double *x, double *y, std::size_t count) const {
+         if (_n == 0) {
+            return;
+         }
+         switch (_n) {
+            case 2:
+               run<2>(x, y, count);
+               break;
+            case 3:
+               run<3>(x, y, count);
+               break;
+            case 4:
+               run<4>(x, y, count);
+               break;
+            case 5:
+               run<5>(x, y, count);
+               break;
+            default:
+               run<0>(x, y, count);
+         }
+      }
+
+#ifdef EIGEN_ENABLED
+
+      /* Map as an Eigen matrix, so whole clouds can go through one
+         matrix product */
+      Eigen::MatrixXd matrix() const {
+         Eigen::MatrixXd M(_n, _n);
+         for (unsigned int i = 0; i < _n; i++) {
+            for (unsigned int j = 0; j < _n; j++) {
+               M(i, j) = _m[i * _n + j];
+            }
+         }
+         return M;
+      }
+
+      /* Transform the columns of an n x N matrix */
+      Eigen::MatrixXd apply(const Eigen::MatrixXd &X) const {
+         Eigen::MatrixXd Y(_n, X.cols());
+         this->apply(X.data(), Y.data(), X.cols());
+         return Y;
+      }
+#endif
+
+   private:
+
+      /* N is the dimension when it is small enough to unroll, 0 for the
+         general loop */
+      template<unsigned int N>
+      void run(const double *x, double *y, std::size_t count) const {
+         const unsigned int n = N ? N : _n;
+         const double *m = &_m[0];
+         long np = (long) count;
+
+#ifdef OMP_ENABLED
+#pragma omp parallel if (count * n * n >= GCA_OMP_THRESHOLD)
+#endif
+         {
+            double buf[N ? N : 1];
+            std::vector<double> dyn(N ? 0 : n);
+            double *t = N ? buf : &dyn[0];
+#ifdef OMP_ENABLED
+#pragma omp for schedule(static)
+#endif
+            for (long p = 0; p < np; p++) {
+               const double *xp = x + p * n;
+               double *yp = y + p * n;
+               for (unsigned int i = 0; i < n; i++) {
+                  double s = 0;
+                  for (unsigned int j = 0; j < n; j++) {
+                     s += m[i * n + j] * xp[j];
+                  }
+                  t[i] = s;
+               }
+               for (unsigned int i = 0; i < n; i++) {
+                  yp[i] = t[i];
+               }
+            }
+         }
+      }
+
+      unsigned int _n;
+      std::vector<double> _m;
+   };
+
+   /* y = R x ~R for count n-vectors stored contiguously in x. This is the
+      plain sandwich: R is taken to be a unit even versor (a rotor), with
+      no normalization and no grade involution; see versorApply in Mvec.h
+      for general versors */
+   inline void sandwichBatch(const Mvec &R, const double *x, double *y,
+           unsigned int n, std::size_t count) {
+      VersorMap(R, n).apply(x, y, count);
+   }
+
+}
+
+#endif	/* BATCH_H */
@@ -1,49 +1,44 @@
 #ifndef BLADE_H
 #define	BLADE_H
 
+#include "Bmask.h"
+#include "SmallVector.h"
 #include <vector>
 #include <string>
 #include <sstream>
 #include <math.h>
 #include <iostream>
 
+/* Blades stored inside every Mvec before its list moves to the heap;
+   0 makes blades_t a plain std::vector */
+#ifndef GCA_INLINE_BLADES
+#define GCA_INLINE_BLADES  8
+#endif
+
 namespace gca
 {
 
-typedef std::vector<unsigned long> ebase_t;
-
 class Blade {
 public:
 
-   Blade() : _e() {
-      _v = 0;
+   Blade() : _e(), _v(0) {
    }
 
-   Blade(double v) {
-      _v = v;
+   Blade(double v) : _e(), _v(v) {
    }
 
-   Blade(double v, unsigned long e) {
-       _e.push_back(e);
-       _v = v;
+   Blade(double v, unsigned long e) : _e(bkey_t::base(e)), _v(v) {
    }
 
-   Blade(double v, const ebase_t &e) {
-      _e = e;
-      _v = v;
+   template<class A>
+   Blade(double v, const std::vector<unsigned long, A> &e) : _e(e), _v(v) {
    }
 
-   Blade(const Blade& orig) {
-      _v = orig._v;
-      _e = orig._e;
-   }
-
-   virtual ~Blade() {
-
+   Blade(double v, const bkey_t &e) : _e(e), _v(v) {
    }
 
    unsigned int grade() const {
-      return _e.size();
+      return _e.grade();
    }
 
    void set(double v) {
@@ -54,49 +49,51 @@ public:
       return _v;
    }
 
-   Blade& inner(const Blade &B) const {
+   const bkey_t& key(void) const {
+      return _e;
+   }
+
+   ebase_t base(void) const {
+      return _e.toBase();
+   }
+
+   Blade inner(const Blade &B) const {
       double v = _v * B._v;
 
       // If one of the numbers is scalar, we can speed up
       // calculation
       if (_e.empty()) {
-         return *(new Blade(v, B._e));
+         return Blade(v, B._e);
       } else if (B._e.empty()) {
-         return *(new Blade(v,_e));
+         return Blade(v,_e);
       }
 
-      int sign;
-      bool common = false;
-      ebase_t e = this->emult(_e, B._e, &sign, &common);
-
-      if (common) {
-         return *(new Blade(v * sign, e));
+      // Inner product is non-zero only if bases have a common element
+      if (_e.intersects(B._e)) {
+         return Blade(v * _e.sign(B._e), _e ^ B._e);
       } else {
-         return *(new Blade());
+         return Blade();
       }
    }
 
-   Blade& outer(const Blade &B) const {
+   Blade outer(const Blade &B) const {
       double v = _v * B._v;
 
       // If one of the numbers is scalar, we can speed up
       // calculation
       if (_e.empty() || B._e.empty()) {
-         return *(new Blade());
+         return Blade();
       }
 
-      int sign;
-      bool common = true;
-      ebase_t e = this->emult(_e, B._e, &sign, &common);
-
-      if (common) {
-         return *(new Blade());
+      // Outer product is non-zero only if bases are disjoint
+      if (_e.intersects(B._e)) {
+         return Blade();
       } else {
-         return *(new Blade(v * sign, e));
+         return Blade(v * _e.sign(B._e), _e ^ B._e);
       }
    }
 
-   Blade& conj(void) const {
+   Blade conj(void) const {
       int sign = 1;
       unsigned int k = this->grade();
       if (k > 0) {
@@ -107,7 +104,7 @@ public:
          }
       }
 
-      return *(new Blade(_v * sign, _e));
+      return Blade(_v * sign, _e);
    }
 
    double mag(void) const {
@@ -119,11 +116,11 @@ public:
       return result._v;
    }
 
-   Blade& inv(void) const {
+   Blade inv(void) const {
       /* Inverse of a blade, it's the conjugate of 
          a blade divided by its magnitude 
          Ainv = ~A/(A&(~A)) */
-      return *(new Blade(this->conj() / this->mag()));
+      return this->conj() / this->mag();
    }
 
    std::string toString() const {
@@ -136,12 +133,13 @@ public:
 
       ss << v << " ";
 
-      ebase_t::const_iterator eA_iter = _e.begin();
+      ebase_t e = _e.toBase();
+      ebase_t::const_iterator eA_iter = e.begin();
 
-      while (eA_iter != _e.end()) {
+      while (eA_iter != e.end()) {
          ss << "e" << *eA_iter;
          eA_iter++;
-         if (eA_iter != _e.end()) {
+         if (eA_iter != e.end()) {
             ss << "^";
          }
       }
@@ -169,53 +167,19 @@ public:
       return this->conj();
    }
 
-   Blade& operator=(const Blade& B) {
-      if (this != &B) {
-         _e = B._e;
-         _v = B._v;
-      }
-      return *this;
-
-   }
-
    bool operator==(const Blade& b) const {
 
       /* Comparison of two blades - check if blade bases are identical,
          the blade value are ignored */
-      if (this->grade() != b.grade()) {
-         return false;
-      }
-
-      for (size_t i = 0; i < _e.size(); i++) {
-         if (_e[i] != b._e[i]) {
-            return false;
-         }
-      }
-
-      return true;
+      return _e == b._e;
    }
 
    bool operator<(const Blade& b) const {
-
-      if (this->grade() < b.grade()) {
-         return true;
-      } else if (this->grade() > b.grade()) {
-         return false;
-      }
-
-      for (size_t i = 0; i < _e.size(); i++) {
-         if (_e[i] < b._e[i]) {
-            return true;
-         } else if (_e[i] > b._e[i]) {
-            return false;
-         }
-      }
-
-      return false;
+      return _e < b._e;
    }
 
    unsigned int at(const unsigned int gIndex) const {
-        return _e[gIndex];
+        return _e.at(gIndex);
    }
    
    unsigned int operator[] (const unsigned int gIndex) const {
@@ -227,74 +191,60 @@ public:
       return out;
    }
 
-private:
+protected:
+   bkey_t _e;
+   double _v;
 
-   ebase_t& emult(const ebase_t &eA,
-           const ebase_t &eB,
-           int *sign,
-           bool *common) const {
-
-      bool outer = *common;
-      *common = false;
-      
-      ebase_t *eC = new ebase_t();
-      eC->reserve(eA.size() + eB.size());
-
-      unsigned int iA = eA.size();
-
-      *sign = 1;
-
-      ebase_t::const_iterator eA_iter = eA.begin();
-      ebase_t::const_iterator eB_iter = eB.begin();
-
-      while (true) {
-         if (eA_iter == eA.end()) {
-            eC->insert(eC->end(), eB_iter, eB.end());
-            break;
-         } else if (eB_iter == eB.end()) {
-            eC->insert(eC->end(), eA_iter, eA.end());
-            break;
-         } else if (*eA_iter < *eB_iter) {
-            eC->push_back(*eA_iter);
-            iA--;
-            eA_iter++;
-         } else if (*eB_iter < *eA_iter) {
-            unsigned int flip = iA % 2;
-            if (flip != 0) {
-               *sign = -(*sign);
-            } 
-            eC->push_back(*eB_iter);
-            eB_iter++;
-         } else {
-            *common = true;
-            if (outer) {
-                eC->clear();
-                break;
-            }
-            if(iA) {
-                unsigned int flip = --iA % 2;
-                if (flip != 0) {
-                   *sign = -(*sign);
-                }
-            }
-            eA_iter++;
-            eB_iter++;
-         }
-      }
+};
 
-      // If doing inner product, then we're done - it will be zero
-      if(!outer && !(*common)) {
-          eC->clear();
-      }
+#if GCA_INLINE_BLADES > 0
+typedef SmallVector<Blade, GCA_INLINE_BLADES, GCA_ALLOCATOR<Blade> > blades_t;
+#else
+typedef std::vector<Blade, GCA_ALLOCATOR<Blade> > blades_t;
+#endif
 
-      return *eC;      
+/* Read-only run of canonical blades owned elsewhere: the list of an Mvec
+   or a mapped MvecStore entry. The product routines take spans, so both
+   go through them without copies. */
+class BladeSpan {
+public:
+
+   typedef const Blade* const_iterator;
+
+   BladeSpan() : _b(0), _n(0) {
    }
 
-protected:
-   ebase_t _e;
-   double _v;
+   BladeSpan(const Blade *b, std::size_t n) : _b(b), _n(n) {
+   }
 
+   BladeSpan(const blades_t &b) : _b(b.data()), _n(b.size()) {
+   }
+
+   const_iterator begin() const {
+      return _b;
+   }
+
+   const_iterator end() const {
+      return _b + _n;
+   }
+
+   std::size_t size() const {
+      return _n;
+   }
+
+   bool empty() const {
+      return _n == 0;
+   }
+
+   const Blade& operator[](std::size_t k) const {
+      return _b[k];
+   }
+
+private:
+   const Blade *_b;
+   std::size_t _n;
 };
+
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,532 @@
+/*
+ * File:   Bmask.h
+ *
+ * Blade basis keys. Bmask<W> stores the basis as a W-word bitmask where
+ * basis vector e_i is bit (i-1), so products reduce to XOR and the
+ * reordering sign to popcounts. Blist keeps the sorted list of indices and
+ * is used when the algebra is too large for a fixed-width mask.
+ *
+ * The key type is picked at compile time from GCA_MAX_DIM, the largest
+ * basis index in use (64 by default, i.e. a single word). Building a
+ * mask key from an index outside 1..GCA_MAX_DIM throws std::out_of_range.
+ */
+
+#ifndef BMASK_H
+#define	BMASK_H
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <stdint.h>
+#include <stdexcept>
+#include "Arena.h"
+
+/* Largest basis index of the algebra. The default keeps keys to one
+   word; models with more generators define it, e.g. -DGCA_MAX_DIM=256
+   for four-word masks or above 512 for list keys */
+#ifndef GCA_MAX_DIM
+#define GCA_MAX_DIM  64
+#endif
+
+/* Allocator template of the basis and blade lists; the default draws
+   from the current gca::Arena, if any */
+#ifndef GCA_ALLOCATOR
+#define GCA_ALLOCATOR  gca::Allocator
+#endif
+
+namespace gca
+{
+
+/* Basis of a blade as a sorted list of indices, as taken and returned
+   by the public API */
+typedef std::vector<unsigned long> ebase_t;
+
+/* Storage of list keys, drawn from the allocator */
+typedef std::vector<unsigned long, GCA_ALLOCATOR<unsigned long> > elist_t;
+
+/* The bit helpers are constexpr so the fixed-dimension tables in
+   Algebra.h can be generated from the same sign rule at compile time */
+constexpr unsigned int popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+   return __builtin_popcountll(x);
+#else
+   x = x - ((x >> 1) & 0x5555555555555555ULL);
+   x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+   x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+   return (unsigned int) ((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+constexpr unsigned int ctz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+   return __builtin_ctzll(x);
+#else
+   unsigned int n = 0;
+   while (!(x & 1)) {
+      x >>= 1;
+      n++;
+   }
+   return n;
+#endif
+}
+
+/* Bit j of the result is the parity of the bits of x above position j */
+constexpr uint64_t parityAbove64(uint64_t x) {
+   uint64_t p = x >> 1;
+   p ^= p >> 1;
+   p ^= p >> 2;
+   p ^= p >> 4;
+   p ^= p >> 8;
+   p ^= p >> 16;
+   p ^= p >> 32;
+   return p;
+}
+
+/* Reordering sign of e_A e_B for masks of the first 64 basis vectors */
+constexpr int sign64(uint64_t a, uint64_t b) {
+   return (popcount64(parityAbove64(a) & b) & 1) ? -1 : 1;
+}
+
+template<unsigned int W>
+class Bmask {
+public:
+
+   /* Number of basis vectors the mask can hold */
+   static const unsigned int maxDim = 64 * W;
+
+   Bmask() {
+      for (unsigned int k = 0; k < W; k++) {
+         _w[k] = 0;
+      }
+   }
+
+   /* Mask of a list of basis indices, whatever its allocator */
+   template<class A>
+   explicit Bmask(const std::vector<unsigned long, A> &e) {
+      for (unsigned int k = 0; k < W; k++) {
+         _w[k] = 0;
+      }
+      typename std::vector<unsigned long, A>::const_iterator i;
+      for (i = e.begin(); i != e.end(); i++) {
+         Bmask::check(*i);
+         _w[(*i - 1) / 64] |= ((uint64_t) 1) << ((*i - 1) % 64);
+      }
+   }
+
+   static Bmask base(unsigned long e) {
+      Bmask::check(e);
+      Bmask m;
+      m._w[(e - 1) / 64] = ((uint64_t) 1) << ((e - 1) % 64);
+      return m;
+   }
+
+   /* Mask of the first 64 basis vectors e1..e64 */
+   static Bmask fromBits(uint64_t bits) {
+      Bmask m;
+      m._w[0] = bits;
+      return m;
+   }
+
+   uint64_t bits() const {
+      return _w[0];
+   }
+
+   /* Mask of n words, word k holding e_(64k+1)..e_(64k+64); words
+      beyond the width of the mask must be zero */
+   static Bmask fromWords(const uint64_t *w, unsigned int n) {
+      Bmask m;
+      for (unsigned int k = 0; k < n; k++) {
+         if (k < W) {
+            m._w[k] = w[k];
+         } else if (w[k]) {
+            throw std::out_of_range("gca: basis index outside 1..GCA_MAX_DIM");
+         }
+      }
+      return m;
+   }
+
+   /* Write the mask as n words, zero beyond the width of the mask */
+   void toWords(uint64_t *w, unsigned int n) const {
+      for (unsigned int k = 0; k < n; k++) {
+         w[k] = k < W ? _w[k] : 0;
+      }
+   }
+
+   /* Largest basis index in the mask, 0 for the scalar */
+   unsigned long top() const {
+      for (unsigned int k = W; k > 0; k--) {
+         if (_w[k - 1]) {
+            unsigned long e = 64 * (k - 1) + 1;
+            for (uint64_t w = _w[k - 1]; w >>= 1;) {
+               e++;
+            }
+            return e;
+         }
+      }
+      return 0;
+   }
+
+   /* True if no basis vector beyond e64 is set */
+   bool narrow() const {
+      for (unsigned int k = 1; k < W; k++) {
+         if (_w[k]) {
+            return false;
+         }
+      }
+      return true;
+   }
+
+   unsigned int grade() const {
+      unsigned int g = 0;
+      for (unsigned int k = 0; k < W; k++) {
+         g += popcount64(_w[k]);
+      }
+      return g;
+   }
+
+   bool empty() const {
+      for (unsigned int k = 0; k < W; k++) {
+         if (_w[k]) {
+            return false;
+         }
+      }
+      return true;
+   }
+
+   /* Index (starting at 1) of the gIndex-th basis vector in
+      ascending order */
+   unsigned long at(unsigned int gIndex) const {
+      for (unsigned int k = 0; k < W; k++) {
+         unsigned int n = popcount64(_w[k]);
+         if (gIndex < n) {
+            uint64_t w = _w[k];
+            while (gIndex-- > 0) {
+               w &= w - 1;
+            }
+            return 64 * k + ctz64(w) + 1;
+         }
+         gIndex -= n;
+      }
+      return 0;
+   }
+
+   ebase_t toBase() const {
+      ebase_t e;
+      e.reserve(grade());
+      for (unsigned int k = 0; k < W; k++) {
+         for (uint64_t w = _w[k]; w; w &= w - 1) {
+            e.push_back(64 * k + ctz64(w) + 1);
+         }
+      }
+      return e;
+   }
+
+   /* Call f with the index of every basis vector, in ascending order */
+   template<class F>
+   void forEach(F f) const {
+      for (unsigned int k = 0; k < W; k++) {
+         for (uint64_t w = _w[k]; w; w &= w - 1) {
+            f(64 * k + ctz64(w) + 1);
+         }
+      }
+   }
+
+   /* Sign of the reordering needed to bring e_A e_B into canonical
+      order, i.e. (-1)^(number of pairs a in A, b in B with a > b) */
+   int sign(const Bmask &b) const {
+      unsigned int n = 0;
+      // Parity of the bits of A in the words above the current one
+      uint64_t carry = 0;
+      for (unsigned int k = W; k-- > 0;) {
+         n += popcount64((parityAbove64(_w[k]) ^ carry) & b._w[k]);
+         carry ^= (popcount64(_w[k]) & 1) ? ~((uint64_t) 0) : 0;
+      }
+      return (n & 1) ? -1 : 1;
+   }
+
+   /* Hash for keyed accumulation, with the word bits spread to the
+      low end used for table indexing */
+   uint64_t hash() const {
+      uint64_t h = 0;
+      for (unsigned int k = 0; k < W; k++) {
+         h = (h ^ _w[k]) * 0x9e3779b97f4a7c15ULL;
+      }
+      return h ^ (h >> 32);
+   }
+
+   bool intersects(const Bmask &b) const {
+      for (unsigned int k = 0; k < W; k++) {
+         if (_w[k] & b._w[k]) {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   Bmask operator^(const Bmask &b) const {
+      Bmask m;
+      for (unsigned int k = 0; k < W; k++) {
+         m._w[k] = _w[k] ^ b._w[k];
+      }
+      return m;
+   }
+
+   Bmask operator&(const Bmask &b) const {
+      Bmask m;
+      for (unsigned int k = 0; k < W; k++) {
+         m._w[k] = _w[k] & b._w[k];
+      }
+      return m;
+   }
+
+   Bmask operator|(const Bmask &b) const {
+      Bmask m;
+      for (unsigned int k = 0; k < W; k++) {
+         m._w[k] = _w[k] | b._w[k];
+      }
+      return m;
+   }
+
+   bool operator==(const Bmask &b) const {
+      for (unsigned int k = 0; k < W; k++) {
+         if (_w[k] != b._w[k]) {
+            return false;
+         }
+      }
+      return true;
+   }
+
+   bool operator!=(const Bmask &b) const {
+      return !(*this == b);
+   }
+
+   /* Canonical order: by grade, then lexicographically on the sorted
+      basis indices. For equal grades the mask holding the lowest
+      differing bit comes first. */
+   bool operator<(const Bmask &b) const {
+      unsigned int gA = grade();
+      unsigned int gB = b.grade();
+      if (gA != gB) {
+         return gA < gB;
+      }
+      for (unsigned int k = 0; k < W; k++) {
+         uint64_t d = _w[k] ^ b._w[k];
+         if (d) {
+            return (_w[k] & d & (~d + 1)) != 0;
+         }
+      }
+      return false;
+   }
+
+private:
+
+   /* The mask has no bit for indices outside 1..maxDim; algebras that
+      use them need a larger GCA_MAX_DIM */
+   static void check(unsigned long e) {
+      if (e < 1 || e > maxDim) {
+         throw std::out_of_range("gca: basis index outside 1..GCA_MAX_DIM");
+      }
+   }
+
+   uint64_t _w[W];
+};
+
+/* Fallback key for algebras larger than the widest mask: the basis kept
+   as a sorted list of indices, multiplied by merging */
+class Blist {
+public:
+
+   static const unsigned int maxDim = ~0U;
+
+   Blist() {
+   }
+
+   template<class A>
+   explicit Blist(const std::vector<unsigned long, A> &e)
+   : _e(e.begin(), e.end()) {
+      if (!_e.empty() && _e.front() == 0) {
+         throw std::out_of_range("gca: basis indices start at 1");
+      }
+   }
+
+   static Blist base(unsigned long e) {
+      if (e == 0) {
+         throw std::out_of_range("gca: basis indices start at 1");
+      }
+      Blist m;
+      m._e.push_back(e);
+      return m;
+   }
+
+   static Blist fromBits(uint64_t bits) {
+      Blist m;
+      for (; bits; bits &= bits - 1) {
+         m._e.push_back(ctz64(bits) + 1);
+      }
+      return m;
+   }
+
+   uint64_t bits() const {
+      uint64_t w = 0;
+      for (elist_t::const_iterator i = _e.begin(); i != _e.end() && *i <= 64; i++) {
+         w |= ((uint64_t) 1) << (*i - 1);
+      }
+      return w;
+   }
+
+   static Blist fromWords(const uint64_t *w, unsigned int n) {
+      Blist m;
+      for (unsigned int k = 0; k < n; k++) {
+         for (uint64_t bits = w[k]; bits; bits &= bits - 1) {
+            m._e.push_back(64 * k + ctz64(bits) + 1);
+         }
+      }
+      return m;
+   }
+
+   void toWords(uint64_t *w, unsigned int n) const {
+      for (unsigned int k = 0; k < n; k++) {
+         w[k] = 0;
+      }
+      for (elist_t::const_iterator i = _e.begin(); i != _e.end() && *i <= 64 * n; i++) {
+         w[(*i - 1) / 64] |= ((uint64_t) 1) << ((*i - 1) % 64);
+      }
+   }
+
+   unsigned long top() const {
+      return _e.empty() ? 0 : _e.back();
+   }
+
+   bool narrow() const {
+      return _e.empty() || _e.back() <= 64;
+   }
+
+   unsigned int grade() const {
+      return _e.size();
+   }
+
+   bool empty() const {
+      return _e.empty();
+   }
+
+   unsigned long at(unsigned int gIndex) const {
+      return gIndex < _e.size() ? _e[gIndex] : 0;
+   }
+
+   ebase_t toBase() const {
+      return ebase_t(_e.begin(), _e.end());
+   }
+
+   template<class F>
+   void forEach(F f) const {
+      for (elist_t::const_iterator i = _e.begin(); i != _e.end(); i++) {
+         f(*i);
+      }
+   }
+
+   int sign(const Blist &b) const {
+      unsigned int n = 0;
+      unsigned int iA = _e.size();
+
+      elist_t::const_iterator eA_iter = _e.begin();
+      elist_t::const_iterator eB_iter = b._e.begin();
+
+      while (eA_iter != _e.end() && eB_iter != b._e.end()) {
+         if (*eA_iter < *eB_iter) {
+            iA--;
+            eA_iter++;
+         } else if (*eB_iter < *eA_iter) {
+            n += iA;
+            eB_iter++;
+         } else {
+            n += --iA;
+            eA_iter++;
+            eB_iter++;
+         }
+      }
+      return (n & 1) ? -1 : 1;
+   }
+
+   uint64_t hash() const {
+      uint64_t h = 0;
+      for (elist_t::const_iterator i = _e.begin(); i != _e.end(); i++) {
+         h = (h ^ *i) * 0x9e3779b97f4a7c15ULL;
+      }
+      return h ^ (h >> 32);
+   }
+
+   bool intersects(const Blist &b) const {
+      elist_t::const_iterator eA_iter = _e.begin();
+      elist_t::const_iterator eB_iter = b._e.begin();
+
+      while (eA_iter != _e.end() && eB_iter != b._e.end()) {
+         if (*eA_iter < *eB_iter) {
+            eA_iter++;
+         } else if (*eB_iter < *eA_iter) {
+            eB_iter++;
+         } else {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   Blist operator^(const Blist &b) const {
+      Blist m;
+      m._e.reserve(_e.size() + b._e.size());
+      std::set_symmetric_difference(_e.begin(), _e.end(),
+              b._e.begin(), b._e.end(), std::back_inserter(m._e));
+      return m;
+   }
+
+   Blist operator&(const Blist &b) const {
+      Blist m;
+      std::set_intersection(_e.begin(), _e.end(),
+              b._e.begin(), b._e.end(), std::back_inserter(m._e));
+      return m;
+   }
+
+   Blist operator|(const Blist &b) const {
+      Blist m;
+      m._e.reserve(_e.size() + b._e.size());
+      std::set_union(_e.begin(), _e.end(),
+              b._e.begin(), b._e.end(), std::back_inserter(m._e));
+      return m;
+   }
+
+   bool operator==(const Blist &b) const {
+      return _e == b._e;
+   }
+
+   bool operator!=(const Blist &b) const {
+      return _e != b._e;
+   }
+
+   bool operator<(const Blist &b) const {
+      if (_e.size() != b._e.size()) {
+         return _e.size() < b._e.size();
+      }
+      return _e < b._e;
+   }
+
+private:
+   elist_t _e;
+};
+
+/* Narrowest key able to hold GCA_MAX_DIM basis vectors; beyond 512 the
+   sorted list is used */
+template<unsigned int W, bool Wide = (W > 8)>
+struct BkeySelect {
+   typedef Bmask<W> type;
+};
+
+template<unsigned int W>
+struct BkeySelect<W, true> {
+   typedef Blist type;
+};
+
+typedef BkeySelect<(GCA_MAX_DIM + 63) / 64>::type bkey_t;
+
+}
+
+#endif	/* BMASK_H */
@@ -0,0 +1,225 @@
+/*
+ * File:   DenseMvec.h
+ *
+ * Dense multivector for low-dimensional algebras. All 2^N coefficients
+ * are kept in a flat array indexed by the basis bitmask (bit k set for
+ * e_{k+1}), the same layout as the first word of a Bmask, so products
+ * are table-driven loops with no allocation.
+ */
+
+#ifndef DENSEMVEC_H
+#define	DENSEMVEC_H
+
+#include "Mvec.h"
+#include "Simd.h"
+#include <math.h>
+
+namespace gca {
+
+   template<unsigned int N>
+   class DenseMvec {
+   public:
+
+      static const unsigned int dim = N;
+      static const unsigned int size = 1u << N;
+
+      DenseMvec() {
+         for (unsigned int k = 0; k < size; k++) {
+            _c[k] = 0;
+         }
+      }
+
+      DenseMvec(double v) {
+         for (unsigned int k = 0; k < size; k++) {
+            _c[k] = 0;
+         }
+         _c[0] = v;
+      }
+
+      /* Blades with basis vectors beyond e_N are dropped */
+      explicit DenseMvec(const Mvec &m) {
+         for (unsigned int k = 0; k < size; k++) {
+            _c[k] = 0;
+         }
+         blades_t::const_iterator i;
+         for (i = m.blades().begin(); i != m.blades().end(); i++) {
+            uint64_t e = i->key().bits();
+            if (i->key().narrow() && e < size) {
+               _c[e] += i->get();
+            }
+         }
+      }
+
+      Mvec toMvec() const {
+         blades_t blades;
+         for (unsigned int k = 0; k < size; k++) {
+            if (_c[k] > GCA_PRECISION || _c[k] < (-GCA_PRECISION)) {
+               blades.push_back(Blade(_c[k], bkey_t::fromBits(k)));
+            }
+         }
+         if (blades.empty()) {
+            return Mvec(0.0);
+         }
+         return Mvec(blades);
+      }
+
+      double get(unsigned int e) const {
+         return _c[e];
+      }
+
+      void set(unsigned int e, double v) {
+         _c[e] = v;
+      }
+
+      const double* data() const {
+         return _c;
+      }
+
+      double* data() {
+         return _c;
+      }
+
+      DenseMvec mul(const DenseMvec &m) const {
+         DenseMvec result;
+         product(_c, m._c, result._c, tables().geo);
+         return result;
+      }
+
+      DenseMvec inner(const DenseMvec &m) const {
+         DenseMvec result;
+         product(_c, m._c, result._c, tables().inr);
+         return result;
+      }
+
+      DenseMvec outer(const DenseMvec &m) const {
+         DenseMvec result;
+         product(_c, m._c, result._c, tables().out);
+         return result;
+      }
+
+      DenseMvec conj() const {
+         DenseMvec result;
+         for (unsigned int k = 0; k < size; k++) {
+            result._c[k] = tables().rev[k] * _c[k];
+         }
+         return result;
+      }
+
+      DenseMvec grade(unsigned int g) const {
+         DenseMvec result;
+         if (g <= N) {
+            simdKernels().project(_c, tables().grade + g * size,
+                    result._c, size);
+         }
+         return result;
+      }
+
+      /* Same as Mvec::mag, the sum of the blade magnitudes A&(~A) */
+      double mag() const {
+         double m = 0;
+         for (unsigned int k = 0; k < size; k++) {
+            m += _c[k] * _c[k];
+         }
+         return m;
+      }
+
+      double norm() const {
+         return sqrt(this->mag());
+      }
+
+      DenseMvec operator*(const DenseMvec &m) const {
+         return this->mul(m);
+      }
+
+      DenseMvec operator&(const DenseMvec &m) const {
+         return this->inner(m);
+      }
+
+      DenseMvec operator^(const DenseMvec &m) const {
+         return this->outer(m);
+      }
+
+      DenseMvec operator*(double x) const {
+         DenseMvec result;
+         for (unsigned int k = 0; k < size; k++) {
+            result._c[k] = _c[k] * x;
+         }
+         return result;
+      }
+
+      DenseMvec operator+(const DenseMvec &m) const {
+         DenseMvec result;
+         for (unsigned int k = 0; k < size; k++) {
+            result._c[k] = _c[k] + m._c[k];
+         }
+         return result;
+      }
+
+      DenseMvec operator-(const DenseMvec &m) const {
+         DenseMvec result;
+         for (unsigned int k = 0; k < size; k++) {
+            result._c[k] = _c[k] - m._c[k];
+         }
+         return result;
+      }
+
+      DenseMvec operator~(void) const {
+         return this->conj();
+      }
+
+      DenseMvec operator[](const unsigned int nIndex) const {
+         return this->grade(nIndex);
+      }
+
+      friend std::ostream& operator<<(std::ostream &out, const DenseMvec &m) {
+         out << m.toMvec();
+         return out;
+      }
+
+   protected:
+
+      /* Sign tables laid out by target: entry [i*size + k] is the factor
+         of a[i]*b[i^k] in c[k], zero where the pair does not contribute */
+      struct Tables {
+         double geo[size * size];
+         double inr[size * size];
+         double out[size * size];
+         double rev[size];
+         double grade[(N + 1) * size];
+
+         Tables() {
+            for (unsigned int i = 0; i < size; i++) {
+               for (unsigned int k = 0; k < size; k++) {
+                  unsigned int j = i ^ k;
+                  double s = Bmask<1>::fromBits(i).sign(Bmask<1>::fromBits(j));
+                  bool common = (i & j) != 0;
+
+                  geo[i * size + k] = s;
+                  inr[i * size + k] = (i == 0 || j == 0 || common) ? s : 0;
+                  out[i * size + k] = (i != 0 && j != 0 && !common) ? s : 0;
+               }
+               unsigned int g = popcount64(i);
+               rev[i] = ((g * (g - 1) / 2) % 2 == 1) ? -1 : 1;
+               for (unsigned int k = 0; k <= N; k++) {
+                  grade[k * size + i] = (g == k) ? 1 : 0;
+               }
+            }
+         }
+      };
+
+      static const Tables& tables() {
+         static const Tables t;
+         return t;
+      }
+
+      static void product(const double *a, const double *b, double *c,
+              const double *table) {
+         simdKernels().product(a, b, c, table, size);
+      }
+
+      double _c[size];
+   };
+
+}
+
+#endif	/* DENSEMVEC_H */
@@ -0,0 +1,496 @@
+/*
+ * File:   Expr.h
+ *
+ * Lazy multivector arithmetic, enabled with GCA_LAZY_ENABLED. The Mvec
+ * operators + - * & ^ / then build an expression tree instead of a
+ * result, and the tree is evaluated when it is assigned to an Mvec:
+ * the sums, differences and scalings around products are accumulated
+ * into one keyed table and canonicalized once, so A*B + C*D - E forms no
+ * intermediate multivector. Products take the plan cache, basis index
+ * and threads of the eager ones (Mvec::accumulateProduct). Products whose
+ * operands are themselves expressions evaluate those operands first.
+ * Sums of plain operands, such as S = S + t, are merged one operand at a
+ * time like the eager operators, which is linear in the blades.
+ *
+ * A grade projection of a product of two multivectors, (A*B)[k], is
+ * routed to gradeProduct. Sandwiches are not detected, since Mvec's
+ * sandwich assumes a versor; call Mvec::sandwich directly for those.
+ *
+ * Expressions hold references to their Mvec operands and are meant to
+ * be evaluated within the statement that builds them.
+ */
+
+#ifndef EXPR_H
+#define	EXPR_H
+
+#include "Mvec.h"
+#include <deque>
+#include <type_traits>
+
+namespace gca {
+
+   struct ExprTag {
+   };
+
+   template<class E> struct Rev;
+   template<class E> struct Grade;
+
+   template<class E>
+   struct Expr : ExprTag {
+
+      const E& self() const {
+         return static_cast<const E&>(*this);
+      }
+
+      Mvec eval() const {
+         return Mvec(*this);
+      }
+
+      double mag() const {
+         return this->eval().mag();
+      }
+
+      std::string toString() const {
+         return this->eval().toString();
+      }
+
+      Rev<E> operator~(void) const {
+         return Rev<E>(self());
+      }
+
+      Grade<E> operator[](const unsigned int nIndex) const {
+         return Grade<E>(self(), nIndex);
+      }
+
+      friend std::ostream& operator<<(std::ostream &out, const Expr &e) {
+         out << e.eval();
+         return out;
+      }
+   };
+
+   /* Access to Mvec internals and the per-thread accumulators of the
+      evaluator, one per nesting level so that operands evaluated inside
+      a product don't disturb the sum being built around them */
+   class LazyEval {
+   public:
+
+      class Level {
+      public:
+
+         Level() {
+            unsigned int &d = depth();
+            if (pool().size() <= d) {
+               pool().resize(d + 1);
+            }
+            _acc = &pool()[d];
+            _acc->clear();
+            d++;
+         }
+
+         ~Level() {
+            depth()--;
+         }
+
+         Accum& acc() {
+            return *_acc;
+         }
+
+      private:
+         Accum *_acc;
+      };
+
+      static void addBlades(const Mvec &m, double s, Accum &acc) {
+         blades_t::const_iterator i;
+         for (i = m._blades.begin(); i != m._blades.end(); i++) {
+            acc.add(i->key(), s * i->get());
+         }
+      }
+
+      static void addProduct(const Mvec &a, const Mvec &b, int kind,
+              double s, Accum &acc) {
+         Mvec::accumulateProduct(a._blades, b._blades, kind, acc, s);
+      }
+
+      /* out += s*m, as Mvec::operator+= */
+      static void mergeBlades(const Mvec &m, double s, Mvec &out) {
+         Mvec::mergeInto(out._blades, m._blades, s);
+      }
+
+      /* Nothing accumulated, as for an empty grade, gives an empty
+         Mvec; a sum that cancels out gives the zero scalar */
+      static void finish(Accum &acc, Mvec &m) {
+         m._blades.clear();
+         if (acc.size() > 0) {
+            acc.finish(m._blades, true, GCA_PRECISION);
+         }
+      }
+
+   private:
+
+      // A deque, so that growing it keeps the outer levels in place
+      static std::deque<Accum>& pool() {
+         static thread_local std::deque<Accum> p;
+         return p;
+      }
+
+      static unsigned int& depth() {
+         static thread_local unsigned int d = 0;
+         return d;
+      }
+   };
+
+   template<class E> struct Linear;
+
+   template<class E>
+   Mvec evaluate(const E &e, std::false_type) {
+      LazyEval::Level level;
+      e.addTo(level.acc(), 1);
+      Mvec m;
+      LazyEval::finish(level.acc(), m);
+      return m;
+   }
+
+   /* Sums and scalings of Mvec operands merge the canonical lists one
+      operand at a time, as the eager operators do, which is linear in
+      the blades instead of going through the table */
+   template<class E>
+   Mvec evaluate(const E &e, std::true_type) {
+      Mvec m;
+      e.mergeTo(m, 1);
+      return m;
+   }
+
+   template<class E>
+   Mvec evaluate(const E &e) {
+      return evaluate(e, Linear<E>());
+   }
+
+   /* Mvec operand */
+   struct Leaf : Expr<Leaf> {
+      const Mvec &m;
+
+      explicit Leaf(const Mvec &m) : m(m) {
+      }
+
+      void addTo(Accum &acc, double s) const {
+         LazyEval::addBlades(m, s, acc);
+      }
+
+      void mergeTo(Mvec &out, double s) const {
+         LazyEval::mergeBlades(m, s, out);
+      }
+   };
+
+   /* Operand computed when the expression is built */
+   struct Value : Expr<Value> {
+      Mvec m;
+
+      explicit Value(const Mvec &m) : m(m) {
+      }
+
+      void addTo(Accum &acc, double s) const {
+         LazyEval::addBlades(m, s, acc);
+      }
+
+      void mergeTo(Mvec &out, double s) const {
+         LazyEval::mergeBlades(m, s, out);
+      }
+   };
+
+   inline const Mvec& operand(const Leaf &e, Mvec &tmp) {
+      return e.m;
+   }
+
+   inline const Mvec& operand(const Value &e, Mvec &tmp) {
+      return e.m;
+   }
+
+   template<class E>
+   const Mvec& operand(const E &e, Mvec &tmp) {
+      tmp = evaluate(e);
+      return tmp;
+   }
+
+   /* l + s*r */
+   template<class L, class R>
+   struct Sum : Expr<Sum<L, R> > {
+      L l;
+      R r;
+      double s;
+
+      Sum(const L &l, const R &r, double s) : l(l), r(r), s(s) {
+      }
+
+      void addTo(Accum &acc, double x) const {
+         l.addTo(acc, x);
+         r.addTo(acc, x * s);
+      }
+
+      void mergeTo(Mvec &out, double x) const {
+         l.mergeTo(out, x);
+         r.mergeTo(out, x * s);
+      }
+   };
+
+   template<class L, class R, int Kind>
+   struct Prod : Expr<Prod<L, R, Kind> > {
+      L l;
+      R r;
+
+      Prod(const L &l, const R &r) : l(l), r(r) {
+      }
+
+      void addTo(Accum &acc, double s) const {
+         Mvec tmpL;
+         Mvec tmpR;
+         const Mvec &a = operand(l, tmpL);
+         const Mvec &b = operand(r, tmpR);
+         LazyEval::addProduct(a, b, Kind, s, acc);
+      }
+   };
+
+   template<class E>
+   struct Scale : Expr<Scale<E> > {
+      E e;
+      double x;
+
+      Scale(const E &e, double x) : e(e), x(x) {
+      }
+
+      void addTo(Accum &acc, double s) const {
+         e.addTo(acc, s * x);
+      }
+
+      void mergeTo(Mvec &out, double s) const {
+         e.mergeTo(out, s * x);
+      }
+   };
+
+   /* Every coefficient divided by x, as Mvec::div(double) */
+   template<class E>
+   struct Quot : Expr<Quot<E> > {
+      E e;
+      double x;
+
+      Quot(const E &e, double x) : e(e), x(x) {
+      }
+
+      void addTo(Accum &acc, double s) const {
+         Mvec tmp;
+         const Mvec &m = operand(e, tmp);
+         LazyEval::addBlades(m.div(x), s, acc);
+      }
+   };
+
+   /* x added to every coefficient, as Mvec::add(double) */
+   template<class E>
+   struct Shift : Expr<Shift<E> > {
+      E e;
+      double x;
+
+      Shift(const E &e, double x) : e(e), x(x) {
+      }
+
+      void addTo(Accum &acc, double s) const {
+         Mvec tmp;
+         const Mvec &m = operand(e, tmp);
+         LazyEval::addBlades(m.add(x), s, acc);
+      }
+   };
+
+   template<class E>
+   struct Rev : Expr<Rev<E> > {
+      E e;
+
+      explicit Rev(const E &e) : e(e) {
+      }
+
+      void addTo(Accum &acc, double s) const {
+         Mvec tmp;
+         const Mvec &m = operand(e, tmp);
+         blades_t::const_iterator i;
+         for (i = m.blades().begin(); i != m.blades().end(); i++) {
+            acc.add(i->key(), s * i->conj().get());
+         }
+      }
+   };
+
+   template<class E>
+   struct Grade : Expr<Grade<E> > {
+      E e;
+      unsigned int k;
+
+      Grade(const E &e, unsigned int k) : e(e), k(k) {
+      }
+
+      void addTo(Accum &acc, double s) const {
+         Mvec tmp;
+         const Mvec &m = operand(e, tmp);
+         LazyEval::addBlades(m[k], s, acc);
+      }
+   };
+
+   /* Expressions evaluated by merging, see evaluate */
+   template<class E>
+   struct Linear : std::false_type {
+   };
+
+   template<>
+   struct Linear<Leaf> : std::true_type {
+   };
+
+   template<>
+   struct Linear<Value> : std::true_type {
+   };
+
+   template<class L, class R>
+   struct Linear<Sum<L, R> > : std::integral_constant<bool,
+   Linear<L>::value && Linear<R>::value> {
+   };
+
+   template<class E>
+   struct Linear<Scale<E> > : Linear<E> {
+   };
+
+   /* Only the grade k products of two multivectors are formed */
+   template<>
+   inline void Grade<Prod<Leaf, Leaf, PROD_MUL> >::addTo(Accum &acc,
+           double s) const {
+      LazyEval::addBlades(gradeProduct(e.l.m, e.r.m, k), s, acc);
+   }
+
+   /* Operands of the lazy operators: Mvec (and derived classes), taken
+      by reference, and expressions, taken by value */
+   template<class T, bool IsMvec = std::is_convertible<const T*, const Mvec*>::value>
+   struct Term {
+      typedef T type;
+
+      static const T& wrap(const T &t) {
+         return t;
+      }
+   };
+
+   template<class T>
+   struct Term<T, true> {
+      typedef Leaf type;
+
+      static Leaf wrap(const Mvec &m) {
+         return Leaf(m);
+      }
+   };
+
+   template<class A, class B, class T>
+   struct EnableTerms : std::enable_if<
+           (std::is_convertible<const A*, const Mvec*>::value ||
+            std::is_base_of<ExprTag, A>::value) &&
+           (std::is_convertible<const B*, const Mvec*>::value ||
+            std::is_base_of<ExprTag, B>::value), T> {
+   };
+
+   template<class A, class T>
+   struct EnableTerm : EnableTerms<A, A, T> {
+   };
+
+   template<class A, class B>
+   typename EnableTerms<A, B, Prod<typename Term<A>::type,
+   typename Term<B>::type, PROD_INNER> >::type
+   operator&(const A &a, const B &b) {
+      return Prod<typename Term<A>::type, typename Term<B>::type, PROD_INNER>(
+              Term<A>::wrap(a), Term<B>::wrap(b));
+   }
+
+   template<class A, class B>
+   typename EnableTerms<A, B, Prod<typename Term<A>::type,
+   typename Term<B>::type, PROD_OUTER> >::type
+   operator^(const A &a, const B &b) {
+      return Prod<typename Term<A>::type, typename Term<B>::type, PROD_OUTER>(
+              Term<A>::wrap(a), Term<B>::wrap(b));
+   }
+
+   template<class A, class B>
+   typename EnableTerms<A, B, Prod<typename Term<A>::type,
+   typename Term<B>::type, PROD_MUL> >::type
+   operator*(const A &a, const B &b) {
+      return Prod<typename Term<A>::type, typename Term<B>::type, PROD_MUL>(
+              Term<A>::wrap(a), Term<B>::wrap(b));
+   }
+
+   /* Division by a multivector multiplies by its inverse, which is
+      evaluated when the expression is built */
+   template<class A, class B>
+   typename EnableTerms<A, B, Prod<typename Term<A>::type, Value,
+   PROD_MUL> >::type
+   operator/(const A &a, const B &b) {
+      Mvec m = evaluate(Term<B>::wrap(b));
+      return Prod<typename Term<A>::type, Value, PROD_MUL>(
+              Term<A>::wrap(a), Value(m.conj().div(m.mag())));
+   }
+
+   template<class A, class B>
+   typename EnableTerms<A, B, Sum<typename Term<A>::type,
+   typename Term<B>::type> >::type
+   operator+(const A &a, const B &b) {
+      return Sum<typename Term<A>::type, typename Term<B>::type>(
+              Term<A>::wrap(a), Term<B>::wrap(b), 1);
+   }
+
+   template<class A, class B>
+   typename EnableTerms<A, B, Sum<typename Term<A>::type,
+   typename Term<B>::type> >::type
+   operator-(const A &a, const B &b) {
+      return Sum<typename Term<A>::type, typename Term<B>::type>(
+              Term<A>::wrap(a), Term<B>::wrap(b), -1);
+   }
+
+   template<class A>
+   typename EnableTerm<A, Scale<typename Term<A>::type> >::type
+   operator*(const A &a, double x) {
+      return Scale<typename Term<A>::type>(Term<A>::wrap(a), x);
+   }
+
+   template<class A>
+   typename EnableTerm<A, Quot<typename Term<A>::type> >::type
+   operator/(const A &a, double x) {
+      return Quot<typename Term<A>::type>(Term<A>::wrap(a), x);
+   }
+
+   template<class A>
+   typename EnableTerm<A, Shift<typename Term<A>::type> >::type
+   operator+(const A &a, double x) {
+      return Shift<typename Term<A>::type>(Term<A>::wrap(a), x);
+   }
+
+   template<class A>
+   typename EnableTerm<A, Shift<typename Term<A>::type> >::type
+   operator-(const A &a, double x) {
+      return Shift<typename Term<A>::type>(Term<A>::wrap(a), -x);
+   }
+
+   template<class E>
+   Mvec::Mvec(const Expr<E> &e) : _blades() {
+      Mvec m = evaluate(e.self());
+      _blades.swap(m._blades);
+   }
+
+   template<class E>
+   Mvec& Mvec::operator=(const Expr<E> &e) {
+      Mvec m = evaluate(e.self());
+      _blades.swap(m._blades);
+      return *this;
+   }
+
+   template<class E>
+   Mvec& Mvec::operator+=(const Expr<E> &e) {
+      *this = Leaf(*this) + e.self();
+      return *this;
+   }
+
+   template<class E>
+   Mvec& Mvec::operator-=(const Expr<E> &e) {
+      *this = Leaf(*this) - e.self();
+      return *this;
+   }
+
+}
+
+#endif	/* EXPR_H */
@@ -0,0 +1,141 @@
+/*
+ * File:   Index.h
+ *
+ * Inverted basis index over a canonical blade list: for every basis
+ * vector in use, a bit mask of the blades containing it. Inner products
+ * only need the pairs sharing a basis vector and outer products only
+ * the disjoint ones, so a row of the product ORs the masks of its basis
+ * vectors and visits the set (inner) or clear (outer) bits in ascending
+ * order. The pairs are formed in the same order as a full scan, and the
+ * filtering costs one word operation per 64 blades instead of a key
+ * test per blade.
+ *
+ * The index is not output-sensitive: every row still ORs and scans all
+ * |B|/64 words, so a product costs |A||B|/64 word operations plus the
+ * pairs it forms, however few they are. It pays when the key tests
+ * dominate (wide keys, dense masks); sparse products with only a
+ * handful of surviving pairs still scale with |A||B|.
+ */
+
+#ifndef INDEX_H
+#define	INDEX_H
+
+#include "Blade.h"
+#include <vector>
+#include <algorithm>
+#include <math.h>
+
+/* Products with fewer blade pairs than this never build an index */
+#ifndef GCA_INDEX_MIN_PAIRS
+#define GCA_INDEX_MIN_PAIRS  4096
+#endif
+
+/* Blades of each operand sampled to decide whether to build an index */
+#ifndef GCA_INDEX_SAMPLE
+#define GCA_INDEX_SAMPLE  64
+#endif
+
+namespace gca {
+
+   class BasisIndex {
+   public:
+
+      BasisIndex() : _n(0), _words(0) {
+      }
+
+      explicit BasisIndex(const BladeSpan &B)
+      : _n(B.size()), _words((B.size() + 63) / 64) {
+         for (std::size_t j = 0; j < B.size(); j++) {
+            B[j].key().forEach([&](unsigned long e) {
+               _base.push_back(e);
+            });
+         }
+         std::sort(_base.begin(), _base.end());
+         _base.erase(std::unique(_base.begin(), _base.end()), _base.end());
+
+         _rows.assign(_base.size() * _words, 0);
+         for (std::size_t j = 0; j < B.size(); j++) {
+            B[j].key().forEach([&](unsigned long e) {
+               uint64_t *row = &_rows[this->find(e) * _words];
+               row[j / 64] |= ((uint64_t) 1) << (j % 64);
+            });
+         }
+      }
+
+      /* Number of blades indexed */
+      std::size_t size() const {
+         return _n;
+      }
+
+      /* Words of a mask over the indexed blades */
+      std::size_t words() const {
+         return _words;
+      }
+
+      /* OR into mask the blades sharing a basis vector with e */
+      void mark(const bkey_t &e, std::vector<uint64_t> &mask) const {
+         e.forEach([&](unsigned long b) {
+            std::size_t k = this->find(b);
+            if (k < _base.size()) {
+               const uint64_t *row = &_rows[k * _words];
+               for (std::size_t w = 0; w < _words; w++) {
+                  mask[w] |= row[w];
+               }
+            }
+         });
+      }
+
+      /* Estimate whether indexing B pays off for an inner (or outer)
+         product of A and B. With average grades gA, gB over D basis
+         vectors, a pair shares about x = gA*gB/D of them, so roughly a
+         fraction 1-exp(-x) of the pairs intersects. The index is used
+         when it skips at least half of the pairs and marking a row is
+         cheaper than testing it blade by blade. The grades and D are
+         taken from up to GCA_INDEX_SAMPLE blades of each operand. */
+      static bool pays(const BladeSpan &A,
+              const BladeSpan &B, bool inner) {
+         if (A.size() * B.size() < GCA_INDEX_MIN_PAIRS) {
+            return false;
+         }
+         double gA = 0;
+         double gB = 0;
+         bkey_t used;
+         std::size_t sA = (A.size() + GCA_INDEX_SAMPLE - 1) / GCA_INDEX_SAMPLE;
+         std::size_t sB = (B.size() + GCA_INDEX_SAMPLE - 1) / GCA_INDEX_SAMPLE;
+         std::size_t nA = 0;
+         std::size_t nB = 0;
+         for (std::size_t i = 0; i < A.size(); i += sA, nA++) {
+            gA += A[i].grade();
+            used = used | A[i].key();
+         }
+         for (std::size_t j = 0; j < B.size(); j += sB, nB++) {
+            gB += B[j].grade();
+            used = used | B[j].key();
+         }
+         if (used.grade() == 0) {
+            return false;
+         }
+
+         double x = (gA / nA) * (gB / nB) / used.grade();
+         double visited = inner ? 1 - exp(-x) : exp(-x);
+         double words = (B.size() + 63) / 64;
+         return visited < 0.5 && (gA / nA) * words < B.size() / 4.0;
+      }
+
+   private:
+
+      std::size_t find(unsigned long e) const {
+         std::vector<unsigned long>::const_iterator i =
+                 std::lower_bound(_base.begin(), _base.end(), e);
+         return (i != _base.end() && *i == e) ? i - _base.begin() : _base.size();
+      }
+
+      std::size_t _n;
+      std::size_t _words;
+      std::vector<unsigned long> _base;
+      std::vector<uint64_t> _rows;
+   };
+
+}
+
+#endif	/* INDEX_H */
@@ -9,11 +9,15 @@
 #define	MVEC_H
 
 #include "Blade.h"
+#include "Accum.h"
+#include "Plan.h"
+#include "Index.h"
 #include <list>
 #include <sstream>
 #include <math.h>
 #include <iostream>
 #include <algorithm>
+#include <type_traits>
 
 #ifdef EIGEN_ENABLED
 #include <Eigen/Dense>
@@ -25,12 +29,24 @@
 
 namespace gca {
 
-typedef std::vector<Blade> blades_t;
-
 #ifndef GCA_PRECISION
 #define GCA_PRECISION  1e-12
 #endif
 
+/* Products with fewer blade pairs than this stay serial under OMP_ENABLED;
+   larger ones are split into chunks of GCA_OMP_ROWS blades of the left
+   operand */
+#ifndef GCA_OMP_THRESHOLD
+#define GCA_OMP_THRESHOLD  4096
+#endif
+
+#ifndef GCA_OMP_ROWS
+#define GCA_OMP_ROWS  16
+#endif
+
+   template<class E> struct Expr;
+   class LazyEval;
+
    class Mvec {
    public:
 
@@ -51,6 +67,26 @@ typedef std::vector<Blade> blades_t;
 
       Mvec(const blades_t& blades) {
          _blades = blades;
+         this->sortBlades();
+      }
+
+      template<class A>
+      Mvec(const std::vector<Blade, A>& blades) {
+         _blades.assign(blades.begin(), blades.end());
+         this->sortBlades();
+      }
+
+      /* Blades of the range [first, last), in any order */
+      template<class It, class = typename std::enable_if<!std::is_arithmetic<It>::value>::type>
+      Mvec(It first, It last) {
+         _blades.assign(first, last);
+         this->sortBlades();
+      }
+
+      /* Copy of blades already in canonical order, such as a view of a
+         mapped MvecStore */
+      explicit Mvec(const BladeSpan &blades) {
+         _blades.assign(blades.begin(), blades.end());
       }
 
 #ifdef EIGEN_ENABLED
@@ -74,173 +110,92 @@ typedef std::vector<Blade> blades_t;
          _blades = orig._blades;
       }
 
-      virtual ~Mvec() {
-
+      Mvec(Mvec&& orig) : _blades(std::move(orig._blades)) {
       }
 
-      Mvec& inner(const Mvec &m) const {
-         Mvec *result = new Mvec();
-         const blades_t *mB = &_blades;
-         const blades_t *nB = &m._blades;
-//#ifdef OMP_ENABLED
-         //std::size_t  nops = 
-         
-//#else
-        blades_t::const_iterator i;
-        blades_t::const_iterator j;
+#ifdef GCA_LAZY_ENABLED
 
-        for (i = mB->begin(); i != mB->end(); i++) {
-           for (j = nB->begin(); j != nB->end(); j++) {
-               result->_blades.push_back((*i)&(*j));
-            }
-        }
-//#endif
-          
-/*          
-          
-          const blades_t *nb = &_blades;
-         const blades_t *mb = &m._blades;
-
-
-#ifdef OMP_ENABLED         
-         int P=std::min(omp_get_num_procs(),(int) (nb->size()*mb->size()) ); 
-#pragma omp parallel for shared(result,nb,mb) private(i,j)
-         for(int p=0;p<P;p++) {
-            blades_t *rb = new blades_t();
-            int k=0;
-#else
-            blades_t *rb = &result->_blades;
-#endif
-            for (i = nb->begin(); i != nb->end(); i++) {
-               for (j = mb->begin(); j != mb->end(); j++) {
-#ifdef OMP_ENABLED
-                  if(k++%P != p) {
-                     continue;
-                  }
-#endif               
-                  rb->push_back((*i)&(*j));
-               }
-            }
-#ifdef OMP_ENABLED
-            #pragma omp critical
-            {
-               result->_blades.insert(result->_blades.end(),rb->begin(),rb->end());
-            }
-         }
-#endif*/
-         result->prune();
-         return *result;
-      }
+      /* Evaluate an expression of the lazy layer (Expr.h) */
+      template<class E>
+      Mvec(const Expr<E> &e);
 
-      Mvec& outer(const Mvec &m) const {
-         Mvec *result = new Mvec();
+      template<class E>
+      Mvec& operator=(const Expr<E> &e);
+#endif
 
-         blades_t::const_iterator i;
-         blades_t::const_iterator j;
+      virtual ~Mvec() {
 
-         for (i = _blades.begin(); i != this->_blades.end(); i++) {
-            for (j = m._blades.begin(); j != m._blades.end(); j++) {
-               result->_blades.push_back((*i)^(*j));
-            }
-         }
-         result->prune();
-         return *result;
       }
 
-      Mvec& mul(const Mvec &m) const {
-         Mvec *result = new Mvec();
-
-         blades_t::const_iterator i;
-         blades_t::const_iterator j;
-
-         for (i = _blades.begin(); i != this->_blades.end(); i++) {
-            for (j = m._blades.begin(); j != m._blades.end(); j++) {
-               //std::cout << *i << " & " << *j << " = ";
-               result->_blades.push_back((*i)&(*j));
-               //std::cout << result->_blades.back() << std::endl;
-               //std::cout << *i << " ^ " << *j << " = ";
-               result->_blades.push_back((*i)^(*j));
-               //std::cout << result->_blades.back() << std::endl;
-            }
-         }
-         result->prune();
-         return *result;
+      Mvec inner(const Mvec &m) const {
+         Mvec result;
+         Mvec::productTo(_blades, m._blades, PROD_INNER, result._blades);
+         return result;
       }
 
-      Mvec& mul(const double x) const {
-         Mvec *result = new Mvec();
-
-         blades_t::const_iterator i;
-
-         for (i = _blades.begin(); i != this->_blades.end(); i++) {
-            result->_blades.push_back((*i) * x);
-         }
-         result->prune();
-         return *result;
+      Mvec outer(const Mvec &m) const {
+         Mvec result;
+         Mvec::productTo(_blades, m._blades, PROD_OUTER, result._blades);
+         return result;
       }
 
-      Mvec& div(const double x) const {
-         Mvec *result = new Mvec();
-
-         blades_t::const_iterator i;
-
-         for (i = _blades.begin(); i != this->_blades.end(); i++) {
-            result->_blades.push_back((*i) / x);
-         }
-         result->prune();
-         return *result;
+      Mvec mul(const Mvec &m) const {
+         Mvec result;
+         Mvec::productTo(_blades, m._blades, PROD_MUL, result._blades);
+         return result;
       }
 
-      Mvec& div(const Mvec& m) const {
-         double mMag = m.mag();
-         Mvec mInv = m.conj();
-
-         Mvec *result = new Mvec(this->mul(mInv.div(mMag)));
-
-         result->prune();
-         return *result;
+      /* Product of kind PROD_MUL, PROD_INNER or PROD_OUTER of two
+         canonical blade lists held outside any Mvec, such as the views of
+         a mapped MvecStore */
+      static Mvec product(const BladeSpan &A, const BladeSpan &B, int kind) {
+         Mvec result;
+         Mvec::productTo(A, B, kind, result._blades);
+         return result;
       }
 
-      Mvec& add(const Mvec& m) const {
-         Mvec *result = new Mvec(_blades);
-         result->_blades.insert(result->_blades.end(), m._blades.begin(), m._blades.end());
-
-         result->prune();
-         return *result;
+      Mvec mul(const double x) const {
+         Mvec result(*this);
+         result.scale(x);
+         return result;
       }
 
-      Mvec& add(double x) const {
-         Mvec *result = new Mvec(_blades);
-
+      Mvec div(const double x) const {
+         Mvec result(*this);
+         result.divide(x);
+         return result;
+      }
 
-         blades_t::iterator bi = result->_blades.begin();
-         while (bi != result->_blades.end()) {
-            bi->set(bi->get() + x);
-            bi++;
-         }
-         result->prune();
-         return *result;
+      Mvec div(const Mvec& m) const {
+         return this->mul(m.conj().div(m.mag()));
       }
 
-      Mvec& sub(const Mvec& m) const {
-         Mvec *result = new Mvec(m.mul(-1));
+      Mvec add(const Mvec& m) const {
+         Mvec result;
+         merge(_blades, m._blades, 1, result._blades);
+         return result;
+      }
 
-         result->_blades.insert(result->_blades.end(), _blades.begin(), _blades.end());
+      Mvec add(double x) const {
+         Mvec result(*this);
+         result.shift(x);
+         return result;
+      }
 
-         result->prune();
-         return *result;
+      Mvec sub(const Mvec& m) const {
+         Mvec result;
+         merge(_blades, m._blades, -1, result._blades);
+         return result;
       }
 
-      Mvec& sub(double x) const {
-         Mvec *result = new Mvec(_blades);
+      Mvec sub(double x) const {
+         Mvec result(*this);
+         result.shift(-x);
+         return result;
+      }
 
-         blades_t::iterator bi = result->_blades.begin();
-         while (bi != result->_blades.end()) {
-            bi->set(bi->get() - x);
-            bi++;
-         }
-         result->prune();
-         return *result;
+      const blades_t& blades(void) const {
+         return _blades;
       }
 
       double mag(void) const {
@@ -252,28 +207,83 @@ typedef std::vector<Blade> blades_t;
          return m;
       }
 
-      Mvec& conj() const {
-         Mvec *result = new Mvec();
+      Mvec conj() const {
+         Mvec result(*this);
+         result.reverse();
+         return result;
+      }
 
-         blades_t::const_iterator i;
+      /* R*X*~R for a versor R, without the intermediate multivectors.
+         A versor preserves grade and R (a^b) ~R = (R a ~R)^(R b ~R)/s with
+         s = R ~R, so only the images of the basis vectors used by X are
+         formed, and every blade of X is mapped as the outer product of
+         the images of its vectors. */
+      static Mvec sandwich(const Mvec &R, const Mvec &X) {
+         Mvec result;
+         if (R._blades.empty() || X._blades.empty()) {
+            return result;
+         }
 
-         for (i = _blades.begin(); i != this->_blades.end(); i++) {
-            result->_blades.push_back(i->conj());
+         std::vector<unsigned long> index;
+         blades_t::const_iterator x;
+         for (x = X._blades.begin(); x != X._blades.end(); x++) {
+            for (unsigned int k = 0; k < x->grade(); k++) {
+               index.push_back(x->at(k));
+            }
          }
-         result->prune();
-         return *result;
+         std::sort(index.begin(), index.end());
+         index.erase(std::unique(index.begin(), index.end()), index.end());
+
+         std::vector<Mvec> image;
+         vectorImages(R, index, image);
+
+         double s = R.mag();
+         Accum &acc = Mvec::accum(1);
+         Accum &step = Mvec::accum();
+         blades_t &terms = Mvec::scratch();
+         blades_t::const_iterator t;
+         blades_t::const_iterator u;
+         for (x = X._blades.begin(); x != X._blades.end(); x++) {
+            unsigned int g = x->grade();
+            if (g == 0) {
+               acc.add(x->key(), x->get() * s);
+               continue;
+            }
 
+            // Outer product of the images, one vector at a time
+            terms = image[imageOf(index, x->at(0))]._blades;
+            for (unsigned int k = 1; k < g; k++) {
+               const blades_t &img = image[imageOf(index, x->at(k))]._blades;
+               for (t = terms.begin(); t != terms.end(); t++) {
+                  for (u = img.begin(); u != img.end(); u++) {
+                     if (!t->key().intersects(u->key())) {
+                        step.add(t->key() ^ u->key(),
+                                t->get() * u->get() * t->key().sign(u->key()));
+                     }
+                  }
+               }
+               terms.assign(step.blades().begin(), step.blades().end());
+               step.clear();
+            }
+
+            double v = x->get() * pow(s, 1.0 - g);
+            for (t = terms.begin(); t != terms.end(); t++) {
+               acc.add(t->key(), v * t->get());
+            }
+         }
+
+         acc.finish(result._blades, true, GCA_PRECISION);
+         return result;
       }
 
-      std::string toString() {
+      std::string toString() const {
          std::stringstream ss;
          bool beg = true;
 
          if (_blades.empty()) {
             ss << "0";
          } else {
-            sort(_blades.begin(),_blades.end());
-            blades_t::iterator i;
+            blades_t::const_iterator i;
             for (i = _blades.begin(); i != _blades.end(); i++) {
                if (!beg) {
                   ss << " ";
@@ -288,6 +298,8 @@ typedef std::vector<Blade> blades_t;
          return ss.str();
       }
 
+#ifndef GCA_LAZY_ENABLED
+
       Mvec operator&(const Mvec& m) const {
          return this->inner(m);
       }
@@ -328,6 +340,8 @@ typedef std::vector<Blade> blades_t;
          return this->sub(x);
       }
 
+#endif
+
       Mvec& operator=(const Mvec& m) {
          if (this != &m) {
             _blades = m._blades;
@@ -336,116 +350,801 @@ typedef std::vector<Blade> blades_t;
 
       }
 
-      Mvec& operator~(void) {
+      Mvec& operator=(Mvec&& m) {
+         if (this != &m) {
+            _blades.swap(m._blades);
+         }
+         return *this;
+      }
+
+      Mvec operator~(void) const {
         return this->conj();
       }
+
+      /* In-place updates, with the same results as the binary operators.
+         Sums go through mergeInto, so adding terms over a stable set of
+         keys doesn't rebuild the list; products reuse a per-thread
+         buffer. */
+
+      Mvec& operator+=(const Mvec& m) {
+         if (this == &m) {
+            return *this += Mvec(m);
+         }
+         mergeInto(_blades, m._blades, 1);
+         return *this;
+      }
+
+      Mvec& operator-=(const Mvec& m) {
+         if (this == &m) {
+            return *this -= Mvec(m);
+         }
+         mergeInto(_blades, m._blades, -1);
+         return *this;
+      }
+
+      Mvec& operator+=(double x) {
+         this->shift(x);
+         return *this;
+      }
+
+      Mvec& operator-=(double x) {
+         this->shift(-x);
+         return *this;
+      }
+
+      Mvec& operator*=(double x) {
+         this->scale(x);
+         return *this;
+      }
+
+      Mvec& operator/=(double x) {
+         this->divide(x);
+         return *this;
+      }
+
+      Mvec& operator&=(const Mvec& m) {
+         this->productInPlace(m, PROD_INNER);
+         return *this;
+      }
+
+      Mvec& operator^=(const Mvec& m) {
+         this->productInPlace(m, PROD_OUTER);
+         return *this;
+      }
+
+      Mvec& operator*=(const Mvec& m) {
+         this->productInPlace(m, PROD_MUL);
+         return *this;
+      }
+
+      Mvec& operator/=(const Mvec& m) {
+         return *this *= m.conj().div(m.mag());
+      }
+
+#ifdef GCA_LAZY_ENABLED
+
+      /* Sum an expression of the lazy layer straight into this */
+      template<class E>
+      Mvec& operator+=(const Expr<E> &e);
+
+      template<class E>
+      Mvec& operator-=(const Expr<E> &e);
+#endif
+
+#ifndef GCA_LAZY_ENABLED
+
+      /* Operators taking a temporary on the left reuse its storage for
+         the result, so chains like R*a*~R don't allocate at each step */
+
+      friend Mvec operator&(Mvec&& a, const Mvec& b) {
+         blades_t& tmp = Mvec::scratch();
+         tmp.clear();
+         Mvec::productTo(a._blades, b._blades, PROD_INNER, tmp);
+         a._blades.swap(tmp);
+         return std::move(a);
+      }
+
+      friend Mvec operator^(Mvec&& a, const Mvec& b) {
+         blades_t& tmp = Mvec::scratch();
+         tmp.clear();
+         Mvec::productTo(a._blades, b._blades, PROD_OUTER, tmp);
+         a._blades.swap(tmp);
+         return std::move(a);
+      }
+
+      friend Mvec operator*(Mvec&& a, const Mvec& b) {
+         blades_t& tmp = Mvec::scratch();
+         tmp.clear();
+         Mvec::productTo(a._blades, b._blades, PROD_MUL, tmp);
+         a._blades.swap(tmp);
+         return std::move(a);
+      }
+
+      friend Mvec operator*(Mvec&& a, const double x) {
+         a.scale(x);
+         return std::move(a);
+      }
+
+      friend Mvec operator/(Mvec&& a, const Mvec& b) {
+         return std::move(a) * b.conj().div(b.mag());
+      }
+
+      friend Mvec operator/(Mvec&& a, double x) {
+         a.divide(x);
+         return std::move(a);
+      }
+
+      friend Mvec operator+(Mvec&& a, const Mvec& b) {
+         blades_t& tmp = Mvec::scratch();
+         merge(a._blades, b._blades, 1, tmp);
+         a._blades.swap(tmp);
+         return std::move(a);
+      }
+
+      friend Mvec operator+(const Mvec& a, Mvec&& b) {
+         return std::move(b) + a;
+      }
+
+      friend Mvec operator+(Mvec&& a, Mvec&& b) {
+         return std::move(a) + static_cast<const Mvec&>(b);
+      }
+
+      friend Mvec operator+(Mvec&& a, const double x) {
+         a.shift(x);
+         return std::move(a);
+      }
+
+      friend Mvec operator-(Mvec&& a, const Mvec& b) {
+         blades_t& tmp = Mvec::scratch();
+         merge(a._blades, b._blades, -1, tmp);
+         a._blades.swap(tmp);
+         return std::move(a);
+      }
+
+      friend Mvec operator-(const Mvec& a, Mvec&& b) {
+         blades_t& tmp = Mvec::scratch();
+         merge(a._blades, b._blades, -1, tmp);
+         b._blades.swap(tmp);
+         return std::move(b);
+      }
+
+      friend Mvec operator-(Mvec&& a, Mvec&& b) {
+         return std::move(a) - static_cast<const Mvec&>(b);
+      }
+
+      friend Mvec operator-(Mvec&& a, double x) {
+         a.shift(-x);
+         return std::move(a);
+      }
+
+#endif
+
+      friend Mvec operator~(Mvec&& a) {
+         a.reverse();
+         return std::move(a);
+      }
       
+      /* Grade k part of A*B, the same as (A*B)[k], without forming the
+         other grades. Blades of grades r and s only multiply to grade
+         r+s-2c, c the number of basis vectors they share, so blocks of
+         grades with k outside |r-s|..r+s or of the wrong parity are
+         skipped whole. */
+      friend Mvec gradeProduct(const Mvec &A, const Mvec &B, unsigned int k) {
+         Mvec result;
+         if (A._blades.empty() || B._blades.empty()) {
+            return result;
+         }
+
+         Accum &acc = Mvec::accum();
+         blades_t::const_iterator iA = A._blades.begin();
+         while (iA != A._blades.end()) {
+            unsigned int r = iA->grade();
+            blades_t::const_iterator endA = std::lower_bound(iA,
+                    A._blades.end(), r + 1, gradeLess);
+
+            blades_t::const_iterator iB = B._blades.begin();
+            while (iB != B._blades.end()) {
+               unsigned int s = iB->grade();
+               blades_t::const_iterator endB = std::lower_bound(iB,
+                       B._blades.end(), s + 1, gradeLess);
+
+               if (k + s >= r && k + r >= s && k <= r + s &&
+                   (r + s - k) % 2 == 0) {
+                  blades_t::const_iterator i;
+                  blades_t::const_iterator j;
+                  for (i = iA; i != endA; i++) {
+                     for (j = iB; j != endB; j++) {
+                        bkey_t e = i->key() ^ j->key();
+                        if (e.grade() == k) {
+                           acc.add(e, i->get() * j->get() *
+                                   i->key().sign(j->key()));
+                        }
+                     }
+                  }
+               }
+               iB = endB;
+            }
+            iA = endA;
+         }
+
+         // A vanishing grade is what operator[] gives: empty, except for
+         // the zero scalar of a product that cancels out entirely, which
+         // only the full product can tell
+         acc.finish(result._blades, true, GCA_PRECISION);
+         if (result._blades[0].get() == 0) {
+            result._blades.clear();
+            if (k == 0) {
+               return A.mul(B)[0];
+            }
+         }
+         return result;
+      }
+
+      /* Scalar part of A*B. Only blades with equal bases give a scalar,
+         so this is a single merge of the two canonical lists. */
+      friend double scalar(const Mvec &A, const Mvec &B) {
+         double v = 0;
+         blades_t::const_iterator i = A._blades.begin();
+         blades_t::const_iterator j = B._blades.begin();
+         while (i != A._blades.end() && j != B._blades.end()) {
+            if (*i < *j) {
+               i++;
+            } else if (*j < *i) {
+               j++;
+            } else {
+               v += i->get() * j->conj().get();
+               i++;
+               j++;
+            }
+         }
+         return v;
+      }
+
       Mvec operator[] (const unsigned int nIndex) const {
         Mvec result;
 
-        blades_t::const_iterator i;
-        for(i=_blades.begin();i!=_blades.end();i++) {
-            if(i->grade()== nIndex) {
-                result._blades.push_back(*i);
-            }
+        // Blades are ordered by grade, so the grade is one contiguous run
+        blades_t::const_iterator i = std::lower_bound(_blades.begin(),
+                _blades.end(), nIndex, gradeLess);
+        while (i != _blades.end() && i->grade() == nIndex) {
+            result._blades.push_back(*i);
+            i++;
         }
         return result;
       }
-     
 
-      friend std::ostream& operator<<(std::ostream &out, Mvec &v) {
+      bool operator==(const Mvec& m) const {
+         if (_blades.size() != m._blades.size()) {
+            return false;
+         }
+         for (std::size_t i = 0; i < _blades.size(); i++) {
+            if (!(_blades[i] == m._blades[i]) ||
+                _blades[i].get() != m._blades[i].get()) {
+               return false;
+            }
+         }
+         return true;
+      }
+
+      bool operator!=(const Mvec& m) const {
+         return !(*this == m);
+      }
+
+      friend std::ostream& operator<<(std::ostream &out, const Mvec &v) {
          out << v.toString();
          return out;
       }
 
    protected:
 
+      /* Write the canonical product of A and B to out. Blade pairs
+         are accumulated straight into a keyed table, skipping the pairs
+         that don't contribute, so the work space grows with the output
+         rather than with the number of pairs. As with prune(), zeros are
+         only dropped when the product has at least two blade terms.
+
+         Small products go through the plan cache, so operands whose
+         bases repeat skip the key arithmetic after the second call.
+
+         Sparse inner and outer products of low grade blades go through a
+         BasisIndex of B when BasisIndex::pays estimates that most pairs
+         can be skipped.
+
+         With OMP_ENABLED, large products are split into fixed chunks of
+         rows of A. Each chunk is summed in its own table and
+         the chunk sums are added in row order, so the result does not
+         depend on the number of threads. */
+      static void productTo(const BladeSpan &A, const BladeSpan &B, int kind,
+              blades_t &out) {
+         std::size_t nA = A.size();
+         std::size_t nPairs = nA * B.size();
+         std::size_t nTerms = (kind == PROD_MUL) ? 2 * nPairs : nPairs;
+
+         // An empty operand gives an empty product, never a cached plan
+         if (nPairs == 0) {
+            return;
+         }
+
+         if (nTerms == 1) {
+            out.push_back(kind == PROD_INNER ? A[0] & B[0] : A[0] ^ B[0]);
+            return;
+         }
+
+         if (nPairs <= GCA_PLAN_MAX_PAIRS) {
+            const ProductPlan *plan = Mvec::plans().find(A, B, kind);
+            if (plan) {
+               plan->apply(A, B, out, GCA_PRECISION);
+               return;
+            }
+         }
+
+         BasisIndex index;
+         if (kind != PROD_MUL &&
+             BasisIndex::pays(A, B, kind == PROD_INNER)) {
+            index = BasisIndex(B);
+         }
+         const BasisIndex *pIndex = index.size() > 0 ? &index : 0;
+
+         Accum &acc = Mvec::accum();
+#ifdef OMP_ENABLED
+         if (nPairs >= GCA_OMP_THRESHOLD && nA > GCA_OMP_ROWS) {
+            int nChunks = (int) ((nA + GCA_OMP_ROWS - 1) / GCA_OMP_ROWS);
+            std::vector<blades_t> parts(nChunks);
+
+#pragma omp parallel for schedule(dynamic)
+            for (int c = 0; c < nChunks; c++) {
+               std::size_t iBeg = c * GCA_OMP_ROWS;
+               std::size_t iEnd = std::min(nA, iBeg + GCA_OMP_ROWS);
+               Accum &part = Mvec::accum();
+               Mvec::accumulate(A, B, iBeg, iEnd, kind, part, 1, pIndex);
+               parts[c].assign(part.blades().begin(), part.blades().end());
+               part.clear();
+            }
+
+            blades_t::const_iterator i;
+            for (int c = 0; c < nChunks; c++) {
+               for (i = parts[c].begin(); i != parts[c].end(); i++) {
+                  acc.add(i->key(), i->get());
+               }
+            }
+            acc.finish(out, nTerms >= 2, GCA_PRECISION);
+            return;
+         }
+#endif
+         Mvec::accumulate(A, B, 0, nA, kind, acc, 1, pIndex);
+         acc.finish(out, nTerms >= 2, GCA_PRECISION);
+      }
+
+      /* acc += s * (A kind B), with the plan cache, basis index and
+         threads of productTo. Products that productTo would sum in a
+         single table are summed straight into acc instead, so a sum of
+         such products is canonicalized once. */
+      static void accumulateProduct(const BladeSpan &A, const BladeSpan &B,
+              int kind, Accum &acc, double s) {
+         std::size_t nA = A.size();
+         std::size_t nPairs = nA * B.size();
+         bool direct = nPairs > GCA_PLAN_MAX_PAIRS;
+#ifdef OMP_ENABLED
+         direct = direct && !(nPairs >= GCA_OMP_THRESHOLD && nA > GCA_OMP_ROWS);
+#endif
+         if (!direct) {
+            blades_t m;
+            Mvec::productTo(A, B, kind, m);
+            blades_t::const_iterator i;
+            for (i = m.begin(); i != m.end(); i++) {
+               acc.add(i->key(), s * i->get());
+            }
+            return;
+         }
+
+         BasisIndex index;
+         if (kind != PROD_MUL &&
+             BasisIndex::pays(A, B, kind == PROD_INNER)) {
+            index = BasisIndex(B);
+         }
+         // A product that cancels out is still the zero scalar
+         acc.add(bkey_t(), 0);
+         Mvec::accumulate(A, B, 0, nA, kind, acc, s,
+                 index.size() > 0 ? &index : 0);
+      }
+
+      /* Sum the products of rows [iBeg, iEnd) of A with B into acc,
+         with the blade rules of Blade::inner and Blade::outer. Given an
+         index of B, only the candidate pairs of an inner or outer product
+         are visited, in the same order. */
+      static void accumulate(const BladeSpan &A, const BladeSpan &B,
+              std::size_t iBeg, std::size_t iEnd, int kind, Accum &acc,
+              double s = 1, const BasisIndex *index = 0) {
+         if (index && kind != PROD_MUL) {
+            Mvec::accumulateIndexed(A, B, iBeg, iEnd, kind, acc, s, *index);
+            return;
+         }
+
+         BladeSpan::const_iterator i;
+         BladeSpan::const_iterator j;
+
+         for (i = A.begin() + iBeg; i != A.begin() + iEnd; i++) {
+            const bkey_t &eA = i->key();
+            for (j = B.begin(); j != B.end(); j++) {
+               const bkey_t &eB = j->key();
+               bool scalar = eA.empty() || eB.empty();
+               bool inner = scalar || eA.intersects(eB);
+               if ((kind == PROD_INNER && !inner) ||
+                   (kind == PROD_OUTER && inner)) {
+                  continue;
+               }
+               double v = i->get() * j->get();
+               acc.add(eA ^ eB, s * (scalar ? v : v * eA.sign(eB)));
+            }
+         }
+      }
+
+      static void accumulateIndexed(const BladeSpan &A,
+              const BladeSpan &B, std::size_t iBeg, std::size_t iEnd,
+              int kind, Accum &acc, double s, const BasisIndex &index) {
+         const BladeSpan &b = B;
+         std::size_t nB = b.size();
+         std::size_t nWords = index.words();
+         std::vector<uint64_t> mask(nWords);
+         bool scalarB = nB > 0 && b[0].key().empty();
+
+         for (std::size_t i = iBeg; i < iEnd; i++) {
+            const bkey_t &eA = A[i].key();
+            double vA = A[i].get();
+            if (eA.empty()) {
+               if (kind == PROD_INNER) {
+                  for (std::size_t j = 0; j < nB; j++) {
+                     acc.add(b[j].key(), s * (vA * b[j].get()));
+                  }
+               }
+               continue;
+            }
+
+            // Set bits share a basis vector with eA; a scalar in m always
+            // belongs to the inner product and never to the outer one
+            std::fill(mask.begin(), mask.end(), 0);
+            index.mark(eA, mask);
+            if (scalarB) {
+               mask[0] |= 1;
+            }
+
+            for (std::size_t w = 0; w < nWords; w++) {
+               uint64_t bits = (kind == PROD_INNER) ? mask[w] : ~mask[w];
+               if (w == nWords - 1 && nB % 64) {
+                  bits &= (((uint64_t) 1) << (nB % 64)) - 1;
+               }
+               for (; bits; bits &= bits - 1) {
+                  const Blade &bj = b[64 * w + ctz64(bits)];
+                  const bkey_t &eB = bj.key();
+                  double v = vA * bj.get();
+                  acc.add(eA ^ eB, s * (eB.empty() ? v : v * eA.sign(eB)));
+               }
+            }
+         }
+      }
+
+      void scale(double x) {
+         blades_t::iterator bi;
+         for (bi = _blades.begin(); bi != _blades.end(); bi++) {
+            bi->set(bi->get() * x);
+         }
+         this->filter();
+      }
+
+      void divide(double x) {
+         blades_t::iterator bi;
+         for (bi = _blades.begin(); bi != _blades.end(); bi++) {
+            bi->set(bi->get() / x);
+         }
+         this->filter();
+      }
+
+      void shift(double x) {
+         blades_t::iterator bi;
+         for (bi = _blades.begin(); bi != _blades.end(); bi++) {
+            bi->set(bi->get() + x);
+         }
+         this->filter();
+      }
+
+      void reverse() {
+         blades_t::iterator bi;
+         for (bi = _blades.begin(); bi != _blades.end(); bi++) {
+            *bi = bi->conj();
+         }
+         this->filter();
+      }
+
+      /* Grade 1 parts of R e_a ~R for the basis vectors e_a in index.
+         The term r_i e_a ~r_j lands on e_b only if r_j has the key
+         r_i^e_a^e_b, so instead of forming every pair (i, j) the blades
+         of ~R are looked up by key for each r_i and each e_b that R or
+         index uses. */
+      static void vectorImages(const Mvec &R,
+              const std::vector<unsigned long> &index,
+              std::vector<Mvec> &image) {
+         Accum &rc = Mvec::accum(1);
+         std::vector<unsigned long> dims(index);
+         blades_t::const_iterator r;
+         for (r = R._blades.begin(); r != R._blades.end(); r++) {
+            rc.add(r->key(), r->conj().get());
+            for (unsigned int k = 0; k < r->grade(); k++) {
+               dims.push_back(r->at(k));
+            }
+         }
+         std::sort(dims.begin(), dims.end());
+         dims.erase(std::unique(dims.begin(), dims.end()), dims.end());
+
+         std::vector<bkey_t> eB;
+         for (std::size_t k = 0; k < dims.size(); k++) {
+            eB.push_back(bkey_t::base(dims[k]));
+         }
+
+         std::vector<double> c(dims.size());
+         image.resize(index.size());
+         for (std::size_t a = 0; a < index.size(); a++) {
+            const bkey_t eA = bkey_t::base(index[a]);
+            std::fill(c.begin(), c.end(), 0.0);
+            for (r = R._blades.begin(); r != R._blades.end(); r++) {
+               bkey_t eIA = r->key() ^ eA;
+               double vIA = r->get() * r->key().sign(eA);
+               for (std::size_t k = 0; k < dims.size(); k++) {
+                  const Blade *rJ = rc.find(eIA ^ eB[k]);
+                  if (rJ) {
+                     c[k] += vIA * rJ->get() * eIA.sign(rJ->key());
+                  }
+               }
+            }
+
+            blades_t &blades = image[a]._blades;
+            blades.clear();
+            for (std::size_t k = 0; k < dims.size(); k++) {
+               if (nonzero(c[k])) {
+                  blades.push_back(Blade(c[k], eB[k]));
+               }
+            }
+            if (blades.empty()) {
+               blades.push_back(Blade(0));
+            }
+         }
+         rc.clear();
+      }
+
+      static std::size_t imageOf(const std::vector<unsigned long> &index,
+              unsigned long a) {
+         return std::lower_bound(index.begin(), index.end(), a) - index.begin();
+      }
+
+      /* Per-thread buffer that temporaries swap their storage with */
+      static blades_t& scratch() {
+         static thread_local blades_t buf;
+         return buf;
+      }
+
+      /* Per-thread cache of plans for small repeated products */
+      static PlanCache& plans() {
+         static thread_local PlanCache cache;
+         return cache;
+      }
+
+      /* Per-thread product accumulators, reused across products; the
+         second one holds the intermediate of a fused product */
+      static Accum& accum(int k = 0) {
+         static thread_local Accum acc[2];
+         return acc[k];
+      }
+
+      /* Canonicalize the blade list: combine blades with equal bases
+         and drop the ones that cancel out below GCA_PRECISION. The list
+         is sorted first (stable, so duplicates are summed in the order
+         they were produced) and merged in a single linear pass, which
+         makes the whole thing O(n log n). */
       void prune() {
          if(_blades.size() < 2) {
              return;
          }
-          
-         blades_t unique;
-         //blades_t duplicates;
-         
-         unique.push_back(_blades[0]);
-         
-         for(std::size_t i=1;i<_blades.size();i++) {
-             Blade *b = &_blades[i];
-             blades_t::iterator bi = std::find(unique.begin(),unique.end(),*b);
-             if(bi != unique.end()) {
-                 bi->set(bi->get()+b->get());
-                 //duplicates.push_back(*b);
-             } else {
-                 unique.push_back(*b);
-             }
-         }
-         
-         blades_t unique_nonzero;
-         
-         for(std::size_t i=0;i<unique.size();i++) {
-             Blade *b = &unique[i];
-             double v = b->get();
-
-             if (v > GCA_PRECISION || v < (-GCA_PRECISION)) {
-                 unique_nonzero.push_back(*b);
-                 
-             }
-         }
-         
-         _blades.clear();
-         if(unique_nonzero.empty()) {
-             _blades.push_back(Blade(0));
-         } else {
-             _blades.insert(_blades.end(),unique_nonzero.begin(),unique_nonzero.end());
+
+         std::stable_sort(_blades.begin(), _blades.end());
+         combine(_blades, true);
+      }
+
+      /* Restore canonical order on a list that may be unsorted, without
+         dropping zero blades */
+      void sortBlades() {
+         for (std::size_t i = 1; i < _blades.size(); i++) {
+            if (!(_blades[i - 1] < _blades[i])) {
+               std::stable_sort(_blades.begin(), _blades.end());
+               combine(_blades, false);
+               return;
+            }
+         }
+      }
+
+      /* Drop zero blades from a list that is already canonical */
+      void filter() {
+         if(_blades.size() < 2) {
+             return;
          }
-         
-          /*
+
+         blades_t::iterator out = _blades.begin();
          blades_t::iterator i;
-         blades_t::iterator j;
-         blades_t::iterator k;
+         for (i = _blades.begin(); i != _blades.end(); i++) {
+            if (nonzero(i->get())) {
+               *out = *i;
+               out++;
+            }
+         }
+
+         _blades.erase(out, _blades.end());
+         if(_blades.empty()) {
+             _blades.push_back(Blade(0));
+         }
+      }
 
-         i = this->_blades.begin();
+      /* Sum runs of equal blades of a sorted list in place */
+      static void combine(blades_t &blades, bool dropZeros) {
+         blades_t::iterator out = blades.begin();
+         blades_t::iterator i = blades.begin();
 
-         while (i != this->_blades.end()) {
+         while (i != blades.end()) {
             double v = i->get();
-            if (v < GCA_PRECISION && v > (-GCA_PRECISION)) {
-               k = i;
-               k++;
-               this->_blades.erase(i);
-               i = k;
-               continue;
+            blades_t::iterator j = i + 1;
+            while (j != blades.end() && *j == *i) {
+               v += j->get();
+               j++;
+            }
+
+            if (!dropZeros || nonzero(v)) {
+               *out = Blade(v, i->key());
+               out++;
             }
+            i = j;
+         }
+
+         blades.erase(out, blades.end());
+         if(blades.empty()) {
+             blades.push_back(Blade(0));
+         }
+      }
 
-            j = i;
-            j++;
-            while (j != this->_blades.end()) {
-               if ((*i) == (*j)) {
-                  i->set(i->get() + j->get());
-                  k = j;
-                  k++;
-                  this->_blades.erase(j);
-                  j = k;
+      void productInPlace(const Mvec &m, int kind) {
+         blades_t& tmp = Mvec::scratch();
+         tmp.clear();
+         Mvec::productTo(_blades, m._blades, kind, tmp);
+         _blades.swap(tmp);
+      }
+
+      /* a += s*b, with the result of merge. When b is small next to a,
+         the blades of b whose key is in a are added where they stand,
+         found by binary search, and only new keys are merged in from the
+         back, so the list is not copied. Zeros are only dropped among
+         the blades touched, which matches merge for lists built by Mvec
+         operations. */
+      static void mergeInto(blades_t &a, const blades_t &b, double s) {
+         if (a.size() < 16 || 4 * b.size() > a.size()) {
+            blades_t& tmp = Mvec::scratch();
+            merge(a, b, s, tmp);
+            a.swap(tmp);
+            return;
+         }
+
+         blades_t& extra = Mvec::scratch();
+         extra.clear();
+         bool zeros = false;
+         blades_t::iterator ia = a.begin();
+         blades_t::const_iterator ib;
+         for (ib = b.begin(); ib != b.end(); ib++) {
+            ia = std::lower_bound(ia, a.end(), *ib);
+            if (ia != a.end() && *ia == *ib) {
+               ia->set(ia->get() + ib->get() * s);
+               zeros = zeros || !nonzero(ia->get());
+            } else {
+               double v = ib->get() * s;
+               if (nonzero(v)) {
+                  extra.push_back(Blade(v, ib->key()));
+               }
+            }
+         }
+
+         if (!extra.empty()) {
+            std::size_t n = a.size();
+            a.resize(n + extra.size());
+            blades_t::iterator out = a.end();
+            blades_t::iterator i = a.begin() + n;
+            blades_t::iterator j = extra.end();
+            while (j != extra.begin()) {
+               if (i != a.begin() && *(j - 1) < *(i - 1)) {
+                  *--out = *--i;
                } else {
-                  j++;
+                  *--out = *--j;
                }
             }
-            v = i->get();
-            if (v < GCA_PRECISION && v > (-GCA_PRECISION)) {
-               k = i;
-               k++;
-               this->_blades.erase(i);
-               i = k;
+         }
+
+         if (zeros) {
+            a.erase(std::remove_if(a.begin(), a.end(), isZero), a.end());
+            if (a.empty()) {
+               a.push_back(Blade(0));
+            }
+         }
+      }
+
+      static bool isZero(const Blade &b) {
+         return !nonzero(b.get());
+      }
+
+      /* out = a + s*b for two canonical lists, in one linear merge */
+      static void merge(const blades_t &a, const blades_t &b, double s,
+              blades_t &out) {
+         out.clear();
+         out.reserve(a.size() + b.size());
+
+         bool drop = (a.size() + b.size()) >= 2;
+
+         blades_t::const_iterator ia = a.begin();
+         blades_t::const_iterator ib = b.begin();
+
+         while (ia != a.end() || ib != b.end()) {
+            if (ib == b.end() || (ia != a.end() && *ia < *ib)) {
+               if (!drop || nonzero(ia->get())) {
+                  out.push_back(*ia);
+               }
+               ia++;
+            } else if (ia == a.end() || *ib < *ia) {
+               double v = ib->get() * s;
+               if (!drop || nonzero(v)) {
+                  out.push_back(Blade(v, ib->key()));
+               }
+               ib++;
             } else {
-               i++;
+               double v = ia->get() + ib->get() * s;
+               if (!drop || nonzero(v)) {
+                  out.push_back(Blade(v, ia->key()));
+               }
+               ia++;
+               ib++;
             }
-         }*/
+         }
+
+         if(drop && out.empty()) {
+             out.push_back(Blade(0));
+         }
+      }
+
+      static bool nonzero(double v) {
+         return v > GCA_PRECISION || v < (-GCA_PRECISION);
+      }
+
+      static bool gradeLess(const Blade &b, unsigned int grade) {
+         return b.grade() < grade;
       }
 
       blades_t _blades;
-      
+
+      friend class LazyEval;
    };
+
+   /* Action of a versor V on X, V X' V^-1, where X' is X with its odd
+      grades negated when V is odd (a product of an odd number of
+      vectors). The parity of V is taken from its first blade. */
+   inline Mvec versorApply(const Mvec &V, const Mvec &X) {
+      if (V.blades().empty() || V.blades()[0].grade() % 2 == 0) {
+         return Mvec::sandwich(V, X).div(V.mag());
+      }
+      blades_t blades(X.blades());
+      blades_t::iterator b;
+      for (b = blades.begin(); b != blades.end(); b++) {
+         if (b->grade() % 2 == 1) {
+            b->set(-b->get());
+         }
+      }
+      return Mvec::sandwich(V, Mvec(blades)).div(V.mag());
+   }
 }
 
+#ifdef GCA_LAZY_ENABLED
+#include "Expr.h"
+#endif
+
 #endif	/* MVEC_H */
 
@@ -0,0 +1,239 @@
+/*
+ * File:   Plan.h
+ *
+ * Product plans for operands with a fixed blade structure. A plan is
+ * built from the blade keys of two canonical blade lists and holds the
+ * canonical output keys and, for every contributing pair, its sign and
+ * the index of its target, so executing it on new coefficients is a
+ * flat multiply-add loop with no key arithmetic.
+ *
+ * Pairs are stored in the order Mvec forms them, so a plan sums every
+ * output coefficient in the same order as the direct product.
+ */
+
+#ifndef PLAN_H
+#define	PLAN_H
+
+#include "Blade.h"
+#include <vector>
+#include <algorithm>
+
+/* Products of at most this many blade pairs go through the per-thread
+   plan cache; 0 disables it */
+#ifndef GCA_PLAN_MAX_PAIRS
+#define GCA_PLAN_MAX_PAIRS  256
+#endif
+
+/* Number of slots of the per-thread plan cache */
+#ifndef GCA_PLAN_CACHE
+#define GCA_PLAN_CACHE  64
+#endif
+
+namespace gca {
+
+   /* Product kinds, with the blade rules of Mvec::mul, Mvec::inner and
+      Mvec::outer */
+   enum product_t {
+      PROD_MUL,
+      PROD_INNER,
+      PROD_OUTER
+   };
+
+   class ProductPlan {
+   public:
+
+      ProductPlan() : _kind(PROD_MUL) {
+      }
+
+      ProductPlan(const BladeSpan &A, const BladeSpan &B,
+              int kind) : _kind(kind) {
+         for (std::size_t i = 0; i < A.size(); i++) {
+            _keysA.push_back(A[i].key());
+         }
+         for (std::size_t j = 0; j < B.size(); j++) {
+            _keysB.push_back(B[j].key());
+         }
+
+         std::vector<bkey_t> keys;
+         for (std::size_t i = 0; i < A.size(); i++) {
+            const bkey_t &eA = _keysA[i];
+            for (std::size_t j = 0; j < B.size(); j++) {
+               const bkey_t &eB = _keysB[j];
+               bool scalar = eA.empty() || eB.empty();
+               bool inner = scalar || eA.intersects(eB);
+               if ((kind == PROD_INNER && !inner) ||
+                   (kind == PROD_OUTER && inner)) {
+                  continue;
+               }
+               Term t = {(unsigned int) i, (unsigned int) j, 0,
+                  scalar ? 1.0 : (double) eA.sign(eB)};
+               _terms.push_back(t);
+               keys.push_back(eA ^ eB);
+            }
+         }
+
+         _out = keys;
+         std::sort(_out.begin(), _out.end());
+         _out.erase(std::unique(_out.begin(), _out.end()), _out.end());
+         for (std::size_t k = 0; k < _terms.size(); k++) {
+            _terms[k].c = std::lower_bound(_out.begin(), _out.end(),
+                    keys[k]) - _out.begin();
+         }
+      }
+
+      int kind() const {
+         return _kind;
+      }
+
+      /* Canonical keys of the output coefficients */
+      const std::vector<bkey_t>& keys() const {
+         return _out;
+      }
+
+      std::size_t size() const {
+         return _out.size();
+      }
+
+      /* True if the plan was built for operands with these bases */
+      bool matches(const BladeSpan &A, const BladeSpan &B,
+              int kind) const {
+         if (kind != _kind || A.size() != _keysA.size() ||
+             B.size() != _keysB.size()) {
+            return false;
+         }
+         for (std::size_t i = 0; i < A.size(); i++) {
+            if (A[i].key() != _keysA[i]) {
+               return false;
+            }
+         }
+         for (std::size_t j = 0; j < B.size(); j++) {
+            if (B[j].key() != _keysB[j]) {
+               return false;
+            }
+         }
+         return true;
+      }
+
+      /* c[k] is the coefficient of keys()[k] of the product of the
+         operands with coefficients a and b */
+      void apply(const double *a, const double *b, double *c) const {
+         for (std::size_t k = 0; k < _out.size(); k++) {
+            c[k] = 0;
+         }
+         std::vector<Term>::const_iterator t;
+         for (t = _terms.begin(); t != _terms.end(); t++) {
+            c[t->c] += t->s * a[t->a] * b[t->b];
+         }
+      }
+
+      /* Append the product of two blade lists matching the plan to out,
+         dropping the coefficients within precision of zero; an empty
+         result is the zero scalar */
+      void apply(const BladeSpan &A, const BladeSpan &B,
+              blades_t &out, double precision) const {
+         double c[GCA_PLAN_MAX_PAIRS > 0 ? GCA_PLAN_MAX_PAIRS : 1];
+         std::vector<double> dyn;
+         double *cp = c;
+         if (_out.size() > sizeof (c) / sizeof (c[0])) {
+            dyn.resize(_out.size());
+            cp = &dyn[0];
+         }
+         for (std::size_t k = 0; k < _out.size(); k++) {
+            cp[k] = 0;
+         }
+         std::vector<Term>::const_iterator t;
+         for (t = _terms.begin(); t != _terms.end(); t++) {
+            double v = A[t->a].get() * B[t->b].get();
+            cp[t->c] += t->s * v;
+         }
+
+         std::size_t n = out.size();
+         for (std::size_t k = 0; k < _out.size(); k++) {
+            if (cp[k] > precision || cp[k] < -precision) {
+               out.push_back(Blade(cp[k], _out[k]));
+            }
+         }
+         if (out.size() == n) {
+            out.push_back(Blade(0));
+         }
+      }
+
+   private:
+
+      struct Term {
+         unsigned int a;
+         unsigned int b;
+         unsigned int c;
+         double s;
+      };
+
+      int _kind;
+      std::vector<bkey_t> _keysA;
+      std::vector<bkey_t> _keysB;
+      std::vector<bkey_t> _out;
+      std::vector<Term> _terms;
+   };
+
+   /* Direct-mapped cache of plans keyed by the bases of the operands. A
+      plan is only built the second time its signature comes up, so
+      products that never repeat cost one hash. */
+   class PlanCache {
+   public:
+
+      PlanCache() : _slots(GCA_PLAN_CACHE) {
+      }
+
+      /* Plan for the operands if one is cached, 0 otherwise */
+      const ProductPlan* find(const BladeSpan &A,
+              const BladeSpan &B, int kind) {
+         uint64_t h = signature(A, B, kind);
+         Slot &s = _slots[h % _slots.size()];
+         if (s.sig == h && s.built && s.plan.matches(A, B, kind)) {
+            return &s.plan;
+         }
+         if (s.sig == h && !s.built) {
+            s.plan = ProductPlan(A, B, kind);
+            s.built = true;
+            return &s.plan;
+         }
+         s.sig = h;
+         s.built = false;
+         return 0;
+      }
+
+      void clear() {
+         for (std::size_t k = 0; k < _slots.size(); k++) {
+            _slots[k] = Slot();
+         }
+      }
+
+   private:
+
+      struct Slot {
+         uint64_t sig;
+         bool built;
+         ProductPlan plan;
+
+         Slot() : sig(0), built(false) {
+         }
+      };
+
+      static uint64_t signature(const BladeSpan &A,
+              const BladeSpan &B, int kind) {
+         uint64_t h = kind + 1;
+         for (std::size_t i = 0; i < A.size(); i++) {
+            h = (h ^ A[i].key().hash()) * 0x9e3779b97f4a7c15ULL;
+         }
+         h = (h ^ 0xff51afd7ed558ccdULL) * 0x9e3779b97f4a7c15ULL;
+         for (std::size_t j = 0; j < B.size(); j++) {
+            h = (h ^ B[j].key().hash()) * 0x9e3779b97f4a7c15ULL;
+         }
+         return h ^ (h >> 32);
+      }
+
+      std::vector<Slot> _slots;
+   };
+
+}
+
+#endif	/* PLAN_H */
@@ -0,0 +1,148 @@
+/*
+ * File:   Reduce.h
+ *
+ * Sums and products of ranges of multivectors, reduced over a tree whose
+ * shape depends only on the length of the range. The range is cut into
+ * blocks of GCA_REDUCE_BLOCK multivectors; every block is reduced left
+ * to right, and the block results are then combined pairwise, level by
+ * level, (0,1), (2,3), ... with an odd last one carried up. The result is
+ * the same bit for bit whatever the number of threads.
+ *
+ * A block sum adds all blades of its multivectors into one keyed table
+ * and canonicalizes once; the levels above use Mvec::add. Products keep
+ * the order of the range and use Mvec::mul throughout. Zeros are pruned
+ * with GCA_PRECISION as by add and mul.
+ *
+ * With OMP_ENABLED, the blocks and the nodes of every level are spread
+ * over the threads.
+ */
+
+#ifndef REDUCE_H
+#define	REDUCE_H
+
+#include "Mvec.h"
+#include <iterator>
+
+#ifndef GCA_REDUCE_BLOCK
+#define GCA_REDUCE_BLOCK  16
+#endif
+
+namespace gca {
+
+   namespace detail {
+
+      template<class It>
+      Mvec sumBlock(It first, It last) {
+         if (last - first == 1) {
+            return *first;
+         }
+         static thread_local Accum acc;
+         acc.clear();
+         std::size_t nTerms = 0;
+         for (It m = first; m != last; ++m) {
+            const blades_t &b = static_cast<const Mvec&> (*m).blades();
+            blades_t::const_iterator i;
+            for (i = b.begin(); i != b.end(); i++) {
+               acc.add(i->key(), i->get());
+            }
+            nTerms += b.size();
+         }
+         blades_t out;
+         acc.finish(out, nTerms >= 2, GCA_PRECISION);
+         return Mvec(out);
+      }
+
+      template<class It>
+      Mvec mulBlock(It first, It last) {
+         Mvec p = *first;
+         for (It m = first + 1; m != last; ++m) {
+            p = p.mul(*m);
+         }
+         return p;
+      }
+
+      /* Reduce the blocks with leaf and combine adjacent pairs with node
+         until one multivector is left */
+      template<class It, class Leaf, class Node>
+      Mvec reduceTree(It first, It last, Leaf leaf, Node node) {
+         long n = (long) (last - first);
+         long nBlocks = (n + GCA_REDUCE_BLOCK - 1) / GCA_REDUCE_BLOCK;
+         std::vector<Mvec> level(nBlocks);
+
+#ifdef OMP_ENABLED
+#pragma omp parallel for schedule(dynamic) if (nBlocks > 1)
+#endif
+         for (long k = 0; k < nBlocks; k++) {
+            It b = first + k * GCA_REDUCE_BLOCK;
+            It e = first + std::min(n, (k + 1) * GCA_REDUCE_BLOCK);
+            level[k] = leaf(b, e);
+         }
+
+         while (level.size() > 1) {
+            long nNext = (long) (level.size() + 1) / 2;
+            std::vector<Mvec> next(nNext);
+#ifdef OMP_ENABLED
+#pragma omp parallel for schedule(dynamic) if (nNext > 1)
+#endif
+            for (long k = 0; k < nNext; k++) {
+               if (2 * k + 1 < (long) level.size()) {
+                  next[k] = node(level[2 * k], level[2 * k + 1]);
+               } else {
+                  next[k] = std::move(level[2 * k]);
+               }
+            }
+            level.swap(next);
+         }
+         return std::move(level[0]);
+      }
+
+      struct AddNode {
+
+         Mvec operator()(const Mvec &a, const Mvec &b) const {
+            return a.add(b);
+         }
+      };
+
+      struct MulNode {
+
+         Mvec operator()(const Mvec &a, const Mvec &b) const {
+            return a.mul(b);
+         }
+      };
+   }
+
+   /* Sum of the multivectors in [first, last), the zero multivector if
+      the range is empty */
+   template<class It>
+   Mvec reduce_sum(It first, It last) {
+      if (first == last) {
+         return Mvec();
+      }
+      return detail::reduceTree(first, last, detail::sumBlock<It>,
+              detail::AddNode());
+   }
+
+   /* Product of the multivectors in [first, last) in range order, the
+      scalar 1 if the range is empty */
+   template<class It>
+   Mvec reduce_product(It first, It last) {
+      if (first == last) {
+         return Mvec(1.0);
+      }
+      return detail::reduceTree(first, last, detail::mulBlock<It>,
+              detail::MulNode());
+   }
+
+   template<class M>
+   Mvec reduce_sum(const std::vector<M> &m) {
+      return reduce_sum(m.begin(), m.end());
+   }
+
+   template<class M>
+   Mvec reduce_product(const std::vector<M> &m) {
+      return reduce_product(m.begin(), m.end());
+   }
+
+}
+
+#endif	/* REDUCE_H */
@@ -0,0 +1,241 @@
+/*
+ * File:   Simd.h
+ *
+ * Vectorized kernels for dense coefficient arrays (DenseMvec) with a
+ * scalar fallback. The AVX2 and AVX-512 variants are compiled through
+ * function target attributes, so one binary carries all of them and the
+ * best one the CPU supports is picked at runtime.
+ */
+
+#ifndef SIMD_H
+#define	SIMD_H
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define GCA_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace gca {
+
+   enum isa_t {
+      ISA_SCALAR,
+      ISA_AVX2,
+      ISA_AVX512
+   };
+
+   /* c[k] = sum_i a[i] * t[i*size + k] * b[i^k], the table-driven dense
+      product; size is 2^N */
+   typedef void (*product_kernel_t)(const double *a, const double *b,
+           double *c, const double *t, unsigned int size);
+
+   /* c[k] = m[k] * a[k], grade projection with a 0/1 mask */
+   typedef void (*project_kernel_t)(const double *a, const double *m,
+           double *c, unsigned int size);
+
+   inline void scalarProduct(const double *a, const double *b, double *c,
+           const double *t, unsigned int size) {
+      for (unsigned int k = 0; k < size; k++) {
+         c[k] = 0;
+      }
+      for (unsigned int i = 0; i < size; i++) {
+         double ai = a[i];
+         if (ai == 0) {
+            continue;
+         }
+         const double *ti = t + i * size;
+         for (unsigned int k = 0; k < size; k++) {
+            c[k] += ai * ti[k] * b[i ^ k];
+         }
+      }
+   }
+
+   inline void scalarProject(const double *a, const double *m, double *c,
+           unsigned int size) {
+      for (unsigned int k = 0; k < size; k++) {
+         c[k] = m[k] * a[k];
+      }
+   }
+
+#ifdef GCA_SIMD_X86
+
+   /* The b block feeding lanes k0..k0+3 is the block at (i^k0) & ~3 with
+      lane l read from lane l^(i&3) */
+   __attribute__((target("avx2,fma")))
+   inline void avx2Product(const double *a, const double *b, double *c,
+           const double *t, unsigned int size) {
+      if (size < 4) {
+         scalarProduct(a, b, c, t, size);
+         return;
+      }
+      for (unsigned int k = 0; k < size; k += 4) {
+         _mm256_storeu_pd(c + k, _mm256_setzero_pd());
+      }
+      for (unsigned int i = 0; i < size; i++) {
+         if (a[i] == 0) {
+            continue;
+         }
+         __m256d ai = _mm256_set1_pd(a[i]);
+         const double *ti = t + i * size;
+         unsigned int p = i & 3;
+         for (unsigned int k = 0; k < size; k += 4) {
+            __m256d bv = _mm256_loadu_pd(b + ((i ^ k) & ~3u));
+            if (p & 2) {
+               bv = _mm256_permute2f128_pd(bv, bv, 1);
+            }
+            if (p & 1) {
+               bv = _mm256_permute_pd(bv, 5);
+            }
+            __m256d tv = _mm256_mul_pd(ai, _mm256_loadu_pd(ti + k));
+            __m256d cv = _mm256_fmadd_pd(tv, bv, _mm256_loadu_pd(c + k));
+            _mm256_storeu_pd(c + k, cv);
+         }
+      }
+   }
+
+   __attribute__((target("avx2")))
+   inline void avx2Project(const double *a, const double *m, double *c,
+           unsigned int size) {
+      if (size < 4) {
+         scalarProject(a, m, c, size);
+         return;
+      }
+      for (unsigned int k = 0; k < size; k += 4) {
+         _mm256_storeu_pd(c + k, _mm256_mul_pd(_mm256_loadu_pd(a + k),
+                 _mm256_loadu_pd(m + k)));
+      }
+   }
+
+   /* Same scheme with 8 lanes, the lane permutation l^(i&7) done with a
+      single variable permute */
+   __attribute__((target("avx512f")))
+   inline void avx512Product(const double *a, const double *b, double *c,
+           const double *t, unsigned int size) {
+      if (size < 8) {
+         scalarProduct(a, b, c, t, size);
+         return;
+      }
+      const __m512i iota = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+      for (unsigned int k = 0; k < size; k += 8) {
+         _mm512_storeu_pd(c + k, _mm512_setzero_pd());
+      }
+      for (unsigned int i = 0; i < size; i++) {
+         if (a[i] == 0) {
+            continue;
+         }
+         __m512d ai = _mm512_set1_pd(a[i]);
+         const double *ti = t + i * size;
+         __m512i perm = _mm512_xor_si512(iota, _mm512_set1_epi64(i & 7));
+         for (unsigned int k = 0; k < size; k += 8) {
+            __m512d bv = _mm512_loadu_pd(b + ((i ^ k) & ~7u));
+            bv = _mm512_mask_permutexvar_pd(bv, 0xff, perm, bv);
+            __m512d tv = _mm512_mul_pd(ai, _mm512_loadu_pd(ti + k));
+            __m512d cv = _mm512_fmadd_pd(tv, bv, _mm512_loadu_pd(c + k));
+            _mm512_storeu_pd(c + k, cv);
+         }
+      }
+   }
+
+   __attribute__((target("avx512f")))
+   inline void avx512Project(const double *a, const double *m, double *c,
+           unsigned int size) {
+      if (size < 8) {
+         scalarProject(a, m, c, size);
+         return;
+      }
+      for (unsigned int k = 0; k < size; k += 8) {
+         _mm512_storeu_pd(c + k, _mm512_mul_pd(_mm512_loadu_pd(a + k),
+                 _mm512_loadu_pd(m + k)));
+      }
+   }
+
+#endif
+
+   inline bool isaSupported(isa_t isa) {
+#ifdef GCA_SIMD_X86
+      switch (isa) {
+         case ISA_AVX2:
+            return __builtin_cpu_supports("avx2") &&
+                    __builtin_cpu_supports("fma");
+         case ISA_AVX512:
+            return __builtin_cpu_supports("avx512f");
+         default:
+            return true;
+      }
+#else
+      return isa == ISA_SCALAR;
+#endif
+   }
+
+   inline const char* isaName(isa_t isa) {
+      switch (isa) {
+         case ISA_AVX2:
+            return "avx2";
+         case ISA_AVX512:
+            return "avx512";
+         default:
+            return "scalar";
+      }
+   }
+
+   /* Kernels currently dispatched to */
+   struct SimdKernels {
+      isa_t isa;
+      product_kernel_t product;
+      project_kernel_t project;
+   };
+
+   inline SimdKernels detectKernels() {
+      SimdKernels k = {ISA_SCALAR, scalarProduct, scalarProject};
+#ifdef GCA_SIMD_X86
+      if (isaSupported(ISA_AVX512)) {
+         k.isa = ISA_AVX512;
+         k.product = avx512Product;
+         k.project = avx512Project;
+      } else if (isaSupported(ISA_AVX2)) {
+         k.isa = ISA_AVX2;
+         k.product = avx2Product;
+         k.project = avx2Project;
+      }
+#endif
+      return k;
+   }
+
+   inline SimdKernels& simdKernels() {
+      static SimdKernels k = detectKernels();
+      return k;
+   }
+
+   inline isa_t simdIsa() {
+      return simdKernels().isa;
+   }
+
+   /* Force a kernel set, e.g. for benchmarking; returns false if the CPU
+      does not support it */
+   inline bool setSimdIsa(isa_t isa) {
+      if (!isaSupported(isa)) {
+         return false;
+      }
+      SimdKernels &k = simdKernels();
+      k.isa = isa;
+      switch (isa) {
+#ifdef GCA_SIMD_X86
+         case ISA_AVX2:
+            k.product = avx2Product;
+            k.project = avx2Project;
+            break;
+         case ISA_AVX512:
+            k.product = avx512Product;
+            k.project = avx512Project;
+            break;
+#endif
+         default:
+            k.product = scalarProduct;
+            k.project = scalarProject;
+      }
+      return true;
+   }
+
+}
+
+#endif	/* SIMD_H */
@@ -0,0 +1,437 @@
+/*
+ * File:   SmallVector.h
+ *
+ * Vector with room for N elements inside the object. Up to N elements
+ * need no allocation, so copying a small multivector is a copy of its
+ * blades; longer lists move to storage from the allocator A, which must
+ * be stateless (std::allocator, gca::Allocator). Iterators are plain
+ * pointers and are invalidated by any change of capacity, and also by
+ * moves and swaps of vectors that are still inline.
+ *
+ * The interface follows std::vector, without the allocator arguments,
+ * so code written against a std::vector blade list keeps compiling.
+ */
+
+#ifndef SMALLVECTOR_H
+#define	SMALLVECTOR_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <algorithm>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+namespace gca {
+
+   template<class T, unsigned int N, class A = std::allocator<T> >
+   class SmallVector {
+   public:
+
+      static_assert(N > 0, "SmallVector needs an inline capacity");
+
+      typedef T value_type;
+      typedef T& reference;
+      typedef const T& const_reference;
+      typedef T* iterator;
+      typedef const T* const_iterator;
+      typedef std::reverse_iterator<iterator> reverse_iterator;
+      typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+      typedef std::size_t size_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef A allocator_type;
+
+      SmallVector() : _data(this->local()), _size(0), _cap(N) {
+      }
+
+      SmallVector(const SmallVector &v) : _data(this->local()), _size(0), _cap(N) {
+         this->append(v.begin(), v.end());
+      }
+
+      SmallVector(SmallVector &&v) noexcept
+      : _data(this->local()), _size(0), _cap(N) {
+         this->steal(v);
+      }
+
+      explicit SmallVector(size_type n, const T &x = T())
+      : _data(this->local()), _size(0), _cap(N) {
+         this->resize(n, x);
+      }
+
+      template<class It, class = typename std::enable_if<!std::is_integral<It>::value>::type>
+      SmallVector(It first, It last) : _data(this->local()), _size(0), _cap(N) {
+         this->append(first, last);
+      }
+
+      SmallVector(std::initializer_list<T> l) : _data(this->local()), _size(0), _cap(N) {
+         this->append(l.begin(), l.end());
+      }
+
+      ~SmallVector() {
+         this->clear();
+         this->release();
+      }
+
+      SmallVector& operator=(const SmallVector &v) {
+         if (this != &v) {
+            this->clear();
+            this->append(v.begin(), v.end());
+         }
+         return *this;
+      }
+
+      SmallVector& operator=(SmallVector &&v) noexcept {
+         if (this != &v) {
+            this->clear();
+            this->release();
+            this->steal(v);
+         }
+         return *this;
+      }
+
+      iterator begin() {
+         return _data;
+      }
+
+      const_iterator begin() const {
+         return _data;
+      }
+
+      iterator end() {
+         return _data + _size;
+      }
+
+      const_iterator end() const {
+         return _data + _size;
+      }
+
+      const_iterator cbegin() const {
+         return _data;
+      }
+
+      const_iterator cend() const {
+         return _data + _size;
+      }
+
+      reverse_iterator rbegin() {
+         return reverse_iterator(this->end());
+      }
+
+      const_reverse_iterator rbegin() const {
+         return const_reverse_iterator(this->end());
+      }
+
+      reverse_iterator rend() {
+         return reverse_iterator(this->begin());
+      }
+
+      const_reverse_iterator rend() const {
+         return const_reverse_iterator(this->begin());
+      }
+
+      size_type size() const {
+         return _size;
+      }
+
+      size_type capacity() const {
+         return _cap;
+      }
+
+      size_type max_size() const {
+         return ~(size_type) 0 / sizeof (T);
+      }
+
+      bool empty() const {
+         return _size == 0;
+      }
+
+      /* True while the elements are stored in the object */
+      bool isInline() const {
+         return _data == this->local();
+      }
+
+      T* data() {
+         return _data;
+      }
+
+      const T* data() const {
+         return _data;
+      }
+
+      T& operator[](size_type k) {
+         return _data[k];
+      }
+
+      const T& operator[](size_type k) const {
+         return _data[k];
+      }
+
+      T& at(size_type k) {
+         if (k >= _size) {
+            throw std::out_of_range("SmallVector::at");
+         }
+         return _data[k];
+      }
+
+      const T& at(size_type k) const {
+         if (k >= _size) {
+            throw std::out_of_range("SmallVector::at");
+         }
+         return _data[k];
+      }
+
+      T& front() {
+         return _data[0];
+      }
+
+      const T& front() const {
+         return _data[0];
+      }
+
+      T& back() {
+         return _data[_size - 1];
+      }
+
+      const T& back() const {
+         return _data[_size - 1];
+      }
+
+      void reserve(size_type n) {
+         if (n > _cap) {
+            this->grow(n);
+         }
+      }
+
+      /* Storage is only given back when the vector is destroyed */
+      void shrink_to_fit() {
+      }
+
+      void push_back(const T &x) {
+         if (_size == _cap) {
+            T t(x);
+            this->grow(2 * _cap);
+            new (_data + _size) T(std::move(t));
+         } else {
+            new (_data + _size) T(x);
+         }
+         _size++;
+      }
+
+      void push_back(T &&x) {
+         if (_size == _cap) {
+            T t(std::move(x));
+            this->grow(2 * _cap);
+            new (_data + _size) T(std::move(t));
+         } else {
+            new (_data + _size) T(std::move(x));
+         }
+         _size++;
+      }
+
+      template<class... Args>
+      void emplace_back(Args&&... args) {
+         this->push_back(T(std::forward<Args>(args)...));
+      }
+
+      void pop_back() {
+         _data[--_size].~T();
+      }
+
+      void clear() {
+         this->destroy(_data, _data + _size);
+         _size = 0;
+      }
+
+      void resize(size_type n) {
+         if (n < _size) {
+            this->destroy(_data + n, _data + _size);
+         } else {
+            this->reserve(n);
+            for (T *p = _data + _size; p != _data + n; p++) {
+               new (p) T();
+            }
+         }
+         _size = n;
+      }
+
+      void resize(size_type n, const T &x) {
+         if (n < _size) {
+            this->destroy(_data + n, _data + _size);
+            _size = n;
+         } else if (n > _size) {
+            T t(x);
+            this->reserve(n);
+            for (T *p = _data + _size; p != _data + n; p++) {
+               new (p) T(t);
+            }
+            _size = n;
+         }
+      }
+
+      iterator erase(const_iterator first, const_iterator last) {
+         iterator f = _data + (first - _data);
+         if (first != last) {
+            iterator e = std::move(_data + (last - _data), this->end(), f);
+            this->destroy(e, this->end());
+            _size = e - _data;
+         }
+         return f;
+      }
+
+      iterator erase(const_iterator pos) {
+         return this->erase(pos, pos + 1);
+      }
+
+      iterator insert(const_iterator pos, const T &x) {
+         return this->insert(pos, &x, &x + 1);
+      }
+
+      iterator insert(const_iterator pos, size_type n, const T &x) {
+         SmallVector tmp(n, x);
+         return this->insert(pos, tmp.begin(), tmp.end());
+      }
+
+      iterator insert(const_iterator pos, std::initializer_list<T> l) {
+         return this->insert(pos, l.begin(), l.end());
+      }
+
+      /* The range is copied first, as it may lie in this vector */
+      template<class It, class = typename std::enable_if<!std::is_integral<It>::value>::type>
+      iterator insert(const_iterator pos, It first, It last) {
+         size_type k = pos - _data;
+         SmallVector tmp(first, last);
+         size_type n = tmp.size();
+         this->reserve(_size + n);
+
+         T *p = _data + k;
+         T *e = _data + _size;
+         for (T *s = e; s != p;) {
+            --s;
+            if (s + n >= e) {
+               new (s + n) T(std::move(*s));
+            } else {
+               s[n] = std::move(*s);
+            }
+         }
+         for (size_type j = 0; j < n; j++) {
+            if (p + j < e) {
+               p[j] = std::move(tmp[j]);
+            } else {
+               new (p + j) T(std::move(tmp[j]));
+            }
+         }
+         _size += n;
+         return p;
+      }
+
+      template<class It, class = typename std::enable_if<!std::is_integral<It>::value>::type>
+      void assign(It first, It last) {
+         this->clear();
+         this->append(first, last);
+      }
+
+      void assign(size_type n, const T &x) {
+         T t(x);
+         this->clear();
+         this->resize(n, t);
+      }
+
+      void swap(SmallVector &v) {
+         if (!this->isInline() && !v.isInline()) {
+            std::swap(_data, v._data);
+            std::swap(_size, v._size);
+            std::swap(_cap, v._cap);
+            return;
+         }
+         SmallVector t(std::move(v));
+         v = std::move(*this);
+         *this = std::move(t);
+      }
+
+      friend bool operator==(const SmallVector &a, const SmallVector &b) {
+         return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+      }
+
+      friend bool operator!=(const SmallVector &a, const SmallVector &b) {
+         return !(a == b);
+      }
+
+      friend bool operator<(const SmallVector &a, const SmallVector &b) {
+         return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+      }
+
+   private:
+
+      T* local() {
+         return reinterpret_cast<T*> (_buf);
+      }
+
+      const T* local() const {
+         return reinterpret_cast<const T*> (_buf);
+      }
+
+      template<class It>
+      void append(It first, It last) {
+         this->reserve(_size + std::distance(first, last));
+         for (; first != last; ++first) {
+            new (_data + _size) T(*first);
+            _size++;
+         }
+      }
+
+      static void destroy(T *first, T *last) {
+         for (; first != last; ++first) {
+            first->~T();
+         }
+      }
+
+      /* Take the elements of v, leaving it empty and inline */
+      void steal(SmallVector &v) {
+         if (v.isInline()) {
+            for (size_type k = 0; k < v._size; k++) {
+               new (_data + k) T(std::move(v._data[k]));
+            }
+            _size = v._size;
+            v.clear();
+         } else {
+            _data = v._data;
+            _size = v._size;
+            _cap = v._cap;
+            v._data = v.local();
+            v._size = 0;
+            v._cap = N;
+         }
+      }
+
+      void grow(size_type n) {
+         n = std::max(n, 2 * _cap);
+         T *p = A().allocate(n);
+         for (size_type k = 0; k < _size; k++) {
+            new (p + k) T(std::move(_data[k]));
+         }
+         this->destroy(_data, _data + _size);
+         this->release();
+         _data = p;
+         _cap = n;
+      }
+
+      void release() {
+         if (!this->isInline()) {
+            A().deallocate(_data, _cap);
+            _data = this->local();
+            _cap = N;
+         }
+      }
+
+      T *_data;
+      size_type _size;
+      size_type _cap;
+      alignas(T) unsigned char _buf[N * sizeof (T)];
+   };
+
+}
+
+#endif	/* SMALLVECTOR_H */
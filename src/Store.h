@@ -0,0 +1,351 @@
+/*
+ * File:   Store.h
+ *
+ * Binary container for large collections of multivectors. A file is
+ *
+ *    header   64 bytes, see StoreHeader
+ *    arena    the blades of all multivectors, one after the other, each
+ *             a record of keyWords 64-bit key words (word k holding
+ *             e_(64k+1)..e_(64k+64), as Bmask::toWords) and a double
+ *    index    count+1 64-bit offsets into the arena, in blades:
+ *             multivector i is records index[i] .. index[i+1]-1
+ *
+ * in native byte order, which the header records. Blades are stored in
+ * the canonical order of Mvec with their exact coefficients.
+ *
+ * MvecWriter appends multivectors one at a time and writes the index and
+ * the header on close(), so only the offsets are kept in memory. Until
+ * then the header is left incomplete and the file is rejected.
+ *
+ * MvecStore maps a file with mmap. When the records have the layout of
+ * Blade in this build (Bmask keys of keyWords words), view(i) points
+ * into the mapping and can be passed to the product routines as it is;
+ * get(i) decodes a copy in any build. Reading one multivector touches
+ * the header, two index entries and its own records only.
+ */
+
+#ifndef STORE_H
+#define	STORE_H
+
+#include "Mvec.h"
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define GCA_STORE_VERSION  1
+
+/* Key words per record written by default: the words of a Bmask key,
+   and 8 (512 basis vectors) with list keys */
+#ifndef GCA_STORE_WORDS
+#define GCA_STORE_WORDS  ((GCA_MAX_DIM + 63) / 64 > 8 ? 8 : (GCA_MAX_DIM + 63) / 64)
+#endif
+
+namespace gca {
+
+   struct StoreHeader {
+      char magic[8];
+      uint32_t version;
+      uint32_t keyWords;
+      uint64_t count;
+      uint64_t blades;
+      uint64_t arena;
+      uint64_t index;
+      uint32_t order;
+      uint32_t reserved[3];
+   };
+
+   static_assert(sizeof (StoreHeader) == 64, "StoreHeader must be 64 bytes");
+
+   namespace detail {
+
+      static const char storeMagic[8] = {'G', 'C', 'A', 'M', 'V', 'E', 'C', 0};
+      static const uint32_t storeOrder = 0x01020304;
+
+      /* True if a record of keyWords key words and a double has the
+         layout of Blade, so records can be read as blades in place */
+      inline bool bladeRecords(uint32_t keyWords) {
+         if (!std::is_trivially_copyable<Blade>::value ||
+             sizeof (Blade) != 8 * (keyWords + 1)) {
+            return false;
+         }
+         uint64_t w[8];
+         for (uint32_t k = 0; k < keyWords && k < 8; k++) {
+            w[k] = 0x0101010101010101ULL * (k + 1);
+         }
+         Blade b(-2.5, bkey_t::fromWords(w, keyWords));
+         unsigned char rec[sizeof (Blade)];
+         double v = -2.5;
+         memcpy(rec, w, 8 * keyWords);
+         memcpy(rec + 8 * keyWords, &v, 8);
+         return memcmp(rec, &b, sizeof (Blade)) == 0;
+      }
+   }
+
+   /* Multivector of a mapped MvecStore, valid while the store is open */
+   class MvecView : public BladeSpan {
+   public:
+
+      MvecView() {
+      }
+
+      MvecView(const Blade *b, std::size_t n) : BladeSpan(b, n) {
+      }
+
+      Mvec toMvec() const {
+         return Mvec(static_cast<const BladeSpan&> (*this));
+      }
+
+      Mvec mul(const BladeSpan &b) const {
+         return Mvec::product(*this, b, PROD_MUL);
+      }
+
+      Mvec inner(const BladeSpan &b) const {
+         return Mvec::product(*this, b, PROD_INNER);
+      }
+
+      Mvec outer(const BladeSpan &b) const {
+         return Mvec::product(*this, b, PROD_OUTER);
+      }
+   };
+
+   class MvecWriter {
+   public:
+
+      explicit MvecWriter(const char *path, unsigned int keyWords = GCA_STORE_WORDS)
+      : _f(fopen(path, "wb")), _keyWords(keyWords), _blades(0), _ok(_f != 0) {
+         _offsets.push_back(0);
+         _rec.resize(keyWords + 1);
+         StoreHeader h;
+         memset(&h, 0, sizeof (h));
+         _ok = _ok && keyWords > 0 && fwrite(&h, sizeof (h), 1, _f) == 1;
+      }
+
+      ~MvecWriter() {
+         this->close();
+      }
+
+      /* False once opening or writing has failed */
+      bool ok() const {
+         return _ok;
+      }
+
+      /* Number of multivectors written so far */
+      std::size_t size() const {
+         return _offsets.size() - 1;
+      }
+
+      /* Append m; fails if a blade has basis vectors beyond the key
+         words of the file */
+      bool write(const Mvec &m) {
+         if (!_ok) {
+            return false;
+         }
+         const blades_t &b = m.blades();
+         for (std::size_t j = 0; j < b.size(); j++) {
+            if (b[j].key().top() > 64 * (unsigned long) _keyWords) {
+               _ok = false;
+               return false;
+            }
+            b[j].key().toWords(&_rec[0], _keyWords);
+            double v = b[j].get();
+            memcpy(&_rec[_keyWords], &v, 8);
+            if (fwrite(&_rec[0], 8, _rec.size(), _f) != _rec.size()) {
+               _ok = false;
+               return false;
+            }
+         }
+         _blades += b.size();
+         _offsets.push_back(_blades);
+         return true;
+      }
+
+      /* Write the index and the header and close the file; true if the
+         whole file was written */
+      bool close() {
+         if (!_f) {
+            return _ok;
+         }
+         if (_ok) {
+            StoreHeader h;
+            memset(&h, 0, sizeof (h));
+            memcpy(h.magic, detail::storeMagic, sizeof (h.magic));
+            h.version = GCA_STORE_VERSION;
+            h.keyWords = _keyWords;
+            h.count = this->size();
+            h.blades = _blades;
+            h.arena = sizeof (StoreHeader);
+            h.index = h.arena + _blades * 8 * (_keyWords + 1);
+            h.order = detail::storeOrder;
+            _ok = fwrite(&_offsets[0], 8, _offsets.size(), _f) == _offsets.size()
+                    && fseek(_f, 0, SEEK_SET) == 0
+                    && fwrite(&h, sizeof (h), 1, _f) == 1;
+         }
+         _ok = (fclose(_f) == 0) && _ok;
+         _f = 0;
+         return _ok;
+      }
+
+   private:
+
+      MvecWriter(const MvecWriter&);
+      MvecWriter& operator=(const MvecWriter&);
+
+      FILE *_f;
+      unsigned int _keyWords;
+      uint64_t _blades;
+      bool _ok;
+      std::vector<uint64_t> _offsets;
+      std::vector<uint64_t> _rec;
+   };
+
+   class MvecStore {
+   public:
+
+      MvecStore() : _map(0), _bytes(0), _count(0), _keyWords(0),
+      _arena(0), _index(0), _inPlace(false) {
+      }
+
+      explicit MvecStore(const char *path) : _map(0), _bytes(0), _count(0),
+      _keyWords(0), _arena(0), _index(0), _inPlace(false) {
+         this->open(path);
+      }
+
+      ~MvecStore() {
+         this->close();
+      }
+
+      /* Map the file at path; false if it can't be read, is not a
+         complete store of this version and byte order, or has keys
+         wider than bkey_t can hold in this build */
+      bool open(const char *path) {
+         this->close();
+         int fd = ::open(path, O_RDONLY);
+         if (fd < 0) {
+            return false;
+         }
+         struct stat st;
+         void *map = MAP_FAILED;
+         if (fstat(fd, &st) == 0 && st.st_size >= (off_t) sizeof (StoreHeader)) {
+            map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+         }
+         ::close(fd);
+         if (map == MAP_FAILED) {
+            return false;
+         }
+         _map = static_cast<const char*> (map);
+         _bytes = st.st_size;
+
+         const StoreHeader *h = reinterpret_cast<const StoreHeader*> (_map);
+         uint64_t rec = 8 * (uint64_t) (h->keyWords + 1);
+         bool valid = memcmp(h->magic, detail::storeMagic, sizeof (h->magic)) == 0
+                 && h->version == GCA_STORE_VERSION
+                 && h->order == detail::storeOrder
+                 && h->keyWords > 0 && h->keyWords <= 1024
+                 && 64 * (uint64_t) h->keyWords <= bkey_t::maxDim
+                 && h->arena == sizeof (StoreHeader)
+                 && h->blades <= (_bytes - h->arena) / rec
+                 && h->index == h->arena + h->blades * rec
+                 && h->count < (_bytes - h->index) / 8;
+         if (!valid) {
+            this->close();
+            return false;
+         }
+         _count = h->count;
+         _keyWords = h->keyWords;
+         _arena = _map + h->arena;
+         _index = reinterpret_cast<const uint64_t*> (_map + h->index);
+         _inPlace = detail::bladeRecords(_keyWords);
+         return true;
+      }
+
+      void close() {
+         if (_map) {
+            munmap(const_cast<char*> (_map), _bytes);
+         }
+         _map = 0;
+         _bytes = 0;
+         _count = 0;
+         _inPlace = false;
+      }
+
+      bool isOpen() const {
+         return _map != 0;
+      }
+
+      /* Number of multivectors */
+      std::size_t size() const {
+         return _count;
+      }
+
+      /* True if view() reads the records in place */
+      bool zeroCopy() const {
+         return _inPlace;
+      }
+
+      /* Blades of multivector i, or an empty view if i is out of range,
+         its offsets are corrupt or the records can't be read in place */
+      MvecView view(std::size_t i) const {
+         uint64_t b;
+         uint64_t e;
+         if (!_inPlace || !this->range(i, b, e)) {
+            return MvecView();
+         }
+         return MvecView(reinterpret_cast<const Blade*> (_arena) + b, e - b);
+      }
+
+      /* Copy of multivector i, the empty multivector if i is out of range
+         or its offsets are corrupt */
+      Mvec get(std::size_t i) const {
+         uint64_t b;
+         uint64_t e;
+         if (!this->range(i, b, e)) {
+            return Mvec();
+         }
+         if (_inPlace) {
+            return this->view(i).toMvec();
+         }
+         blades_t blades;
+         std::vector<uint64_t> w(_keyWords);
+         for (uint64_t k = b; k < e; k++) {
+            const char *r = _arena + k * 8 * (_keyWords + 1);
+            double v;
+            memcpy(&w[0], r, 8 * _keyWords);
+            memcpy(&v, r + 8 * _keyWords, 8);
+            blades.push_back(Blade(v, bkey_t::fromWords(&w[0], _keyWords)));
+         }
+         return Mvec(blades);
+      }
+
+   private:
+
+      MvecStore(const MvecStore&);
+      MvecStore& operator=(const MvecStore&);
+
+      bool range(std::size_t i, uint64_t &b, uint64_t &e) const {
+         if (i >= _count) {
+            return false;
+         }
+         b = _index[i];
+         e = _index[i + 1];
+         const StoreHeader *h = reinterpret_cast<const StoreHeader*> (_map);
+         return b <= e && e <= h->blades;
+      }
+
+      const char *_map;
+      std::size_t _bytes;
+      std::size_t _count;
+      uint32_t _keyWords;
+      const char *_arena;
+      const uint64_t *_index;
+      bool _inPlace;
+   };
+
+}
+
+#endif	/* STORE_H */
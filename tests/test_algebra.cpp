@@ -0,0 +1,103 @@
+#include "test_genb.h"
+#include <Algebra>
+#include <DenseMvec>
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+typedef Algebra<3> G3;
+
+const unsigned int numTests = 1000;
+const unsigned int numReps = 100;
+
+int main(int argc, char **argv) {
+
+   vector<Mvec> rotors;
+   vector<Mvec> vectors;
+
+   srand(1);
+
+   for (unsigned int i = 0; i < numTests; i++) {
+      /* Unit vectors, so repeated rotation keeps the magnitude */
+      Mvec m = generate_mvec(8, 3)[1] + Mvec(1, 1);
+      Mvec n = generate_mvec(8, 3)[1] + Mvec(1, 2);
+      Mvec a = generate_mvec(8, 3)[1] + Mvec(1, 3);
+      m = m / sqrt(m.mag());
+      n = n / sqrt(n.mag());
+      rotors.push_back(m * n);
+      vectors.push_back(a);
+   }
+
+   double sparse_secs = 0;
+   double dense_secs = 0;
+   double fixed_secs = 0;
+   double err = 0;
+
+   for (size_t i = 0; i < numTests; i++) {
+      clock_t begin;
+      clock_t end;
+
+      Mvec R = rotors[i];
+      Mvec Rc = ~R;
+      Mvec a = vectors[i];
+      Mvec C;
+
+      begin = clock();
+      for (unsigned int r = 0; r < numReps; r++) {
+         C = R*a*Rc;
+      }
+      end = clock();
+      sparse_secs += double(end - begin);
+
+      DenseMvec<3> dR(R);
+      DenseMvec<3> dRc(Rc);
+      DenseMvec<3> da(a);
+      DenseMvec<3> dC;
+
+      begin = clock();
+      for (unsigned int r = 0; r < numReps; r++) {
+         dC = dR*da*dRc;
+         da = dC[1];
+      }
+      end = clock();
+      dense_secs += double(end - begin);
+
+      G3::Rotor fR(R);
+      G3::Rotor fRc(Rc);
+      G3::Vector fa(a);
+      G3::Vector fC;
+
+      begin = clock();
+      for (unsigned int r = 0; r < numReps; r++) {
+         fC = G3::Vector(fR*fa*fRc);
+         fa = fC;
+      }
+      end = clock();
+      fixed_secs += double(end - begin);
+
+      /* Both fast paths applied the sandwich numReps times */
+      Mvec diff = fC.toMvec() - dC[1].toMvec();
+      err = std::max(err, diff.mag());
+
+      /* One application against the sparse product */
+      G3::Vector f1(G3::Rotor(R)*G3::Vector(a)*G3::Rotor(Rc));
+      err = std::max(err, (C[1] - f1.toMvec()).mag());
+   }
+
+   cout << "# Testing R*a*~R in dim 3" << endl;
+   cout << "#-----------------------------------------------" << endl;
+   cout << "Sparse time taken " << sparse_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Dense time taken " << dense_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Algebra<3> time taken " << fixed_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Max difference " << err << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   return err <= tolerance ? 0 : 1;
+}
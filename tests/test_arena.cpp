@@ -0,0 +1,83 @@
+#include "test_genb.h"
+#include <Mvec>
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numTests = 200;
+
+/* Temporaries of a few products and sums */
+Mvec compute(const Mvec &A, const Mvec &B, const Mvec &C) {
+   Mvec X = A * B + C;
+   Mvec Y = (A ^ C) - (B & C) * 2.0;
+   return X * Y[2] + ~Y;
+}
+
+void report(const char *name, double secs, const AllocStats &s) {
+   cout << name << " time taken " << secs / CLOCKS_PER_SEC << " s." << endl;
+#ifdef GCA_ALLOC_STATS
+   cout << name << " allocations " << s.allocs << " (" << s.arenaAllocs
+           << " from the arena), " << s.bytes << " bytes" << endl;
+   cout << name << " allocator time taken " << s.secs << " s." << endl;
+#endif
+}
+
+int main(int argc, char **argv) {
+
+   vector<Mvec> mvecs;
+
+   srand(1);
+
+   for (unsigned int i = 0; i < numTests + 2; i++) {
+      mvecs.push_back(generate_mvec(20, 10));
+   }
+
+   vector<Mvec> heap(numTests);
+   vector<Mvec> arena(numTests);
+
+   clock_t begin;
+   clock_t end;
+
+   allocStats().clear();
+   begin = clock();
+   for (unsigned int i = 0; i < numTests; i++) {
+      heap[i] = compute(mvecs[i], mvecs[i + 1], mvecs[i + 2]);
+   }
+   end = clock();
+   AllocStats heapStats = allocStats();
+   double heap_secs = double(end - begin);
+
+   allocStats().clear();
+   begin = clock();
+   {
+      Arena scope;
+      for (unsigned int i = 0; i < numTests; i++) {
+         arena[i] = compute(mvecs[i], mvecs[i + 1], mvecs[i + 2]);
+      }
+   }
+   end = clock();
+   AllocStats arenaStats = allocStats();
+   double arena_secs = double(end - begin);
+
+   /* The results outlive the arena */
+   double err = 0;
+   for (unsigned int i = 0; i < numTests; i++) {
+      err = max(err, difference(heap[i], arena[i]));
+   }
+
+   cout << "# Testing temporaries with and without an arena" << endl;
+   cout << "#-----------------------------------------------" << endl;
+   report("Heap", heap_secs, heapStats);
+   report("Arena", arena_secs, arenaStats);
+   cout << "Max difference " << err << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   return err <= tolerance ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+#include "test_genb.h"
+#include <Batch>
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numRotors = 10;
+const unsigned int numPoints = 10000;
+
+/* Unit vector of e1..en */
+Mvec unit_vector(unsigned int n) {
+   Mvec m = Mvec(1, 1 + rand() % n);
+   for (unsigned int k = 1; k <= n; k++) {
+      m = m + Mvec(rand() / (double) RAND_MAX - 0.5, k);
+   }
+   return m / sqrt(m.mag());
+}
+
+int main(int argc, char **argv) {
+
+   double maxErr = 0;
+
+   srand(1);
+
+   for (unsigned int n = 3; n <= 6; n += 3) {
+      vector<Mvec> points;
+      vector<double> coords(numPoints * n);
+
+      for (unsigned int p = 0; p < numPoints; p++) {
+         Mvec a = unit_vector(n);
+         points.push_back(a);
+         for (unsigned int k = 0; k < n; k++) {
+            Mvec c = a & Mvec(1, k + 1);
+            coords[p * n + k] = c.blades()[0].get();
+         }
+      }
+
+      double sparse_secs = 0;
+      double batch_secs = 0;
+      double err = 0;
+
+      for (unsigned int r = 0; r < numRotors; r++) {
+         clock_t begin;
+         clock_t end;
+
+         Mvec R = unit_vector(n) * unit_vector(n);
+         Mvec Rc = ~R;
+         vector<Mvec> C(numPoints);
+         vector<double> y(numPoints * n);
+
+         begin = clock();
+         for (unsigned int p = 0; p < numPoints; p++) {
+            C[p] = R * points[p] * Rc;
+         }
+         end = clock();
+         sparse_secs += double(end - begin);
+
+         begin = clock();
+         sandwichBatch(R, &coords[0], &y[0], n, numPoints);
+         end = clock();
+         batch_secs += double(end - begin);
+
+         for (unsigned int p = 0; p < numPoints; p++) {
+            for (unsigned int k = 0; k < n; k++) {
+               Mvec c = C[p] & Mvec(1, k + 1);
+               err = max(err, fabs(c.blades()[0].get() - y[p * n + k]));
+            }
+         }
+
+         /* Any R, not only a versor: x -> R x ~R is linear all the same */
+         Mvec G = generate_mvec(4, n) + Mvec(1.0);
+         Mvec Gc = ~G;
+         VersorMap general(G, n);
+         for (unsigned int p = 0; p < 10; p++) {
+            Mvec g = general.apply(points[p]);
+            Mvec c = (G * points[p] * Gc)[1];
+            err = max(err, difference(c, g));
+         }
+
+#ifdef EIGEN_ENABLED
+         VersorMap map(R, n);
+         Eigen::Map<Eigen::MatrixXd> X(&coords[0], n, numPoints);
+         Eigen::MatrixXd Y = map.apply(Eigen::MatrixXd(X));
+         err = max(err, (Y - map.matrix() * X).cwiseAbs().maxCoeff());
+#endif
+      }
+
+      cout << "# Testing batched R*a*~R in dim " << n << endl;
+      cout << "#-----------------------------------------------" << endl;
+      cout << "Sparse time taken " << sparse_secs / CLOCKS_PER_SEC << " s." << endl;
+      cout << "Batch time taken " << batch_secs / CLOCKS_PER_SEC << " s." << endl;
+      cout << "Max difference " << err << endl;
+      cout << "#-----------------------------------------------" << endl;
+      maxErr = max(maxErr, err);
+   }
+
+   return maxErr <= tolerance ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include "test_genb.h"
+#include <Mvec>
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numTests = 100;
+const unsigned int numTerms = 2000;
+
+int main(int argc, char **argv) {
+
+   vector<Mvec> mvecs;
+   vector<Mvec> terms;
+
+   srand(1);
+
+   for (unsigned int i = 0; i < numTests + 1; i++) {
+      mvecs.push_back(generate_mvec(20, 10));
+   }
+   for (unsigned int i = 0; i < numTerms; i++) {
+      terms.push_back(generate_mvec(4, 10));
+   }
+
+   double err = 0;
+
+   /* Every compound operator against its binary form */
+   for (unsigned int i = 0; i < numTests; i++) {
+      const Mvec &A = mvecs[i];
+      const Mvec &B = mvecs[i + 1];
+      Mvec C;
+
+      C = A; C += B; err = max(err, difference(C, A + B));
+      C = A; C -= B; err = max(err, difference(C, A - B));
+      C = A; C += 1.5; err = max(err, difference(C, A + 1.5));
+      C = A; C -= 1.5; err = max(err, difference(C, A - 1.5));
+      C = A; C *= 3.0; err = max(err, difference(C, A * 3.0));
+      C = A; C /= 3.0; err = max(err, difference(C, A / 3.0));
+      // Division by a double is exact division on every path
+      C = A; C /= 7.0;
+      {
+         Mvec q = A / 7.0;
+         Mvec r = Mvec(A) / 7.0;
+         err = (C == q && r == A.div(7.0)) ? err : 1;
+      }
+      C = A; C *= B; err = max(err, difference(C, A * B));
+      C = A; C &= B; err = max(err, difference(C, A & B));
+      C = A; C ^= B; err = max(err, difference(C, A ^ B));
+      C = A; C /= B; err = max(err, difference(C, A / B));
+      C = A; C -= C; err = max(err, difference(C, A - A));
+      C = A; C *= C; err = max(err, difference(C, A * A));
+
+      /* Small terms added to a large sum, in place */
+      C = A * B;
+      Mvec D = C;
+      for (unsigned int k = 0; k < 50; k++) {
+         C += terms[k];
+         D = D + terms[k];
+         C -= C[2] * 0.5;
+         D = D - D[2] * 0.5;
+      }
+      err = max(err, difference(C, D));
+   }
+
+   clock_t begin;
+   clock_t end;
+
+   Mvec S;
+   begin = clock();
+   for (unsigned int k = 0; k < numTerms; k++) {
+      S = S + terms[k];
+   }
+   end = clock();
+   double binary_secs = double(end - begin);
+
+   Mvec T;
+   begin = clock();
+   for (unsigned int k = 0; k < numTerms; k++) {
+      T += terms[k];
+   }
+   end = clock();
+   double compound_secs = double(end - begin);
+   err = max(err, difference(S, T));
+
+   cout << "# Testing compound assignment" << endl;
+   cout << "#-----------------------------------------------" << endl;
+   cout << "S = S + t time taken " << binary_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "S += t time taken " << compound_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Blades in the sum " << T.blades().size() << endl;
+   cout << "Max difference " << err << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   return err <= tolerance ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+#include "test_genb.h"
+#include <DenseMvec>
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numTests = 100;
+const unsigned int numReps = 100;
+
+double maxErr = 0;
+
+template<unsigned int N>
+double bench(void) {
+
+   vector<Mvec> mvecs;
+   vector<DenseMvec<N> > dvecs;
+
+   for (unsigned int i = 0; i < numTests; i++) {
+      mvecs.push_back(generate_mvec(DenseMvec<N>::size, N));
+      dvecs.push_back(DenseMvec<N>(mvecs.back()));
+   }
+
+   double sparse_secs = 0;
+   double dense_secs = 0;
+   double err = 0;
+
+   for (size_t i = 0; i < numTests; i++) {
+      clock_t begin;
+      clock_t end;
+
+      Mvec A = mvecs[i];
+      Mvec B = mvecs[(i + 1) % numTests];
+      Mvec C;
+
+      begin = clock();
+      for (unsigned int r = 0; r < numReps; r++) {
+         C = A*B;
+      }
+      end = clock();
+      sparse_secs += double(end - begin);
+
+      DenseMvec<N> dA = dvecs[i];
+      DenseMvec<N> dB = dvecs[(i + 1) % numTests];
+      DenseMvec<N> dC;
+
+      begin = clock();
+      for (unsigned int r = 0; r < numReps; r++) {
+         dC = dA*dB;
+      }
+      end = clock();
+      dense_secs += double(end - begin);
+
+      err = std::max(err, difference(C, dC.toMvec()));
+   }
+
+   cout << "# Testing dim " << N << endl;
+   cout << "#-----------------------------------------------" << endl;
+   cout << "Sparse time taken " << sparse_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Dense time taken " << dense_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Max difference " << err << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   maxErr = std::max(maxErr, err);
+   return dense_secs;
+}
+
+int main(int argc, char **argv) {
+
+   double tot_time = 0;
+
+   srand(1);
+
+   tot_time += bench<2>();
+   tot_time += bench<3>();
+   tot_time += bench<4>();
+   tot_time += bench<5>();
+
+   cout << "#-----------------------------------------------" << endl;
+   cout << "Total time taken " << tot_time / CLOCKS_PER_SEC << " s." << endl << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   return maxErr <= tolerance ? 0 : 1;
+}
@@ -2,6 +2,7 @@
 
 #include <cstdlib>
 #include <algorithm>
+#include <math.h>
 
 using namespace std;
 using namespace gca;
@@ -45,4 +46,19 @@ Mvec generate_mvec(unsigned int maxBlades, unsigned int maxGrade) {
       }
    }
    return Mvec(blades);
-}
\ No newline at end of file
+}
+
+double difference(const Mvec &a, const Mvec &b) {
+   if (a.blades().size() != b.blades().size()) {
+      return 1;
+   }
+   double d = 0;
+   for (size_t j = 0; j < a.blades().size(); j++) {
+      if (a.blades()[j].key() != b.blades()[j].key()) {
+         return 1;
+      }
+      d = max(d, fabs(a.blades()[j].get() - b.blades()[j].get()) /
+              (1 + fabs(a.blades()[j].get())));
+   }
+   return d;
+}
@@ -6,4 +6,11 @@
 gca::Blade generate_blade(unsigned int maxGrade);
 gca::Mvec generate_mvec(unsigned int maxBlades,unsigned int maxGrade);
 
+/* Largest relative difference of the coefficients of a and b, 1 if
+   their blades differ */
+double difference(const gca::Mvec &a, const gca::Mvec &b);
+
+/* Largest difference accepted between two ways of computing a result */
+const double tolerance = 1e-9;
+
 #endif
\ No newline at end of file
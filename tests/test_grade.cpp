@@ -0,0 +1,93 @@
+#include "test_genb.h"
+#include <Mvec>
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numTests = 200;
+
+int main(int argc, char **argv) {
+
+   vector<Mvec> mvecs;
+
+   srand(1);
+
+   for (unsigned int i = 0; i < numTests; i++) {
+      mvecs.push_back(generate_mvec(100, 58));
+   }
+
+   double maxErr = 0;
+
+   for (unsigned int k = 0; k <= 2; k++) {
+      double full_secs = 0;
+      double grade_secs = 0;
+      double err = 0;
+
+      for (size_t i = 1; i < numTests; i++) {
+         clock_t begin;
+         clock_t end;
+
+         const Mvec &A = mvecs[i - 1];
+         const Mvec &B = mvecs[i];
+
+         begin = clock();
+         Mvec C = (A * B)[k];
+         end = clock();
+         full_secs += double(end - begin);
+
+         begin = clock();
+         Mvec G = gradeProduct(A, B, k);
+         end = clock();
+         grade_secs += double(end - begin);
+
+         if (C.blades().size() != G.blades().size()) {
+            err = max(err, 1.0);
+         } else {
+            for (size_t j = 0; j < C.blades().size(); j++) {
+               if (!(C.blades()[j] == G.blades()[j])) {
+                  err = max(err, 1.0);
+               }
+               double d = C.blades()[j].get() - G.blades()[j].get();
+               err = max(err, fabs(d));
+            }
+         }
+
+         if (k == 0) {
+            double c = C.blades().empty() ? 0 : C.blades()[0].get();
+            err = max(err, fabs(c - scalar(A, B)));
+         }
+      }
+
+      cout << "# Testing (A*B)[" << k << "]" << endl;
+      cout << "#-----------------------------------------------" << endl;
+      cout << "Full product time taken " << full_secs / CLOCKS_PER_SEC << " s." << endl;
+      cout << "Grade product time taken " << grade_secs / CLOCKS_PER_SEC << " s." << endl;
+      cout << "Max difference " << err << endl;
+      cout << "#-----------------------------------------------" << endl;
+      maxErr = max(maxErr, err);
+   }
+
+   /* Vanishing grades: (e1+e2)*(e1-e2) = -2 e1^e2 has no scalar part,
+      and a zero scalar operand cancels the whole product */
+   Mvec u = Mvec(1, 1) + Mvec(1, 2);
+   Mvec w = Mvec(1, 1) - Mvec(1, 2);
+   double vanishErr = 0;
+   for (unsigned int k = 0; k <= 3; k++) {
+      vanishErr = max(vanishErr, difference((u * w)[k], gradeProduct(u, w, k)));
+      vanishErr = max(vanishErr, difference((Mvec(0.0) * u)[k],
+              gradeProduct(Mvec(0.0), u, k)));
+      vanishErr = max(vanishErr, difference((mvecs[0] * Mvec(0.0))[k],
+              gradeProduct(mvecs[0], Mvec(0.0), k)));
+   }
+   cout << "Vanishing grade difference " << vanishErr << endl;
+   maxErr = max(maxErr, vanishErr);
+
+   return maxErr <= tolerance ? 0 : 1;
+}
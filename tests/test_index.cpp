@@ -0,0 +1,94 @@
+#include "test_genb.h"
+#include <Mvec>
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numTests = 20;
+const unsigned int numBlades = 300;
+const unsigned int dim = 64;
+
+/* Random multivector of blades of grade 1 to 3 in dim 64 */
+Mvec generate_sparse(unsigned int nBlades) {
+   blades_t blades;
+   for (unsigned int k = 0; k < nBlades; k++) {
+      bkey_t e;
+      unsigned int g = 1 + rand() % 3;
+      while (e.grade() < g) {
+         e = e | bkey_t::base(1 + rand() % dim);
+      }
+      blades.push_back(Blade((double) (rand() % 200) - 100, e));
+   }
+   return Mvec(blades);
+}
+
+/* Pairwise blade products summed without any indexing */
+Mvec reference(const Mvec &A, const Mvec &B, bool inner) {
+   Accum acc;
+   blades_t out;
+   for (size_t i = 0; i < A.blades().size(); i++) {
+      for (size_t j = 0; j < B.blades().size(); j++) {
+         const Blade &a = A.blades()[i];
+         const Blade &b = B.blades()[j];
+         Blade c = inner ? (a & b) : (a ^ b);
+         acc.add(c.key(), c.get());
+      }
+   }
+   acc.finish(out, true, GCA_PRECISION);
+   return Mvec(out);
+}
+
+int main(int argc, char **argv) {
+
+   srand(1);
+
+   double inner_secs = 0;
+   double outer_secs = 0;
+   double ref_secs = 0;
+   double err = 0;
+
+   for (unsigned int i = 0; i < numTests; i++) {
+      clock_t begin;
+      clock_t end;
+
+      Mvec A = generate_sparse(numBlades) + Mvec(2.0);
+      Mvec B = generate_sparse(numBlades);
+
+      begin = clock();
+      Mvec I = A & B;
+      end = clock();
+      inner_secs += double(end - begin);
+
+      begin = clock();
+      Mvec O = A ^ B;
+      end = clock();
+      outer_secs += double(end - begin);
+
+      begin = clock();
+      Mvec rI = reference(A, B, true);
+      Mvec rO = reference(A, B, false);
+      end = clock();
+      ref_secs += double(end - begin);
+
+      err = max(err, difference(I, rI));
+      err = max(err, difference(O, rO));
+      err = max(err, difference(B & A, reference(B, A, true)));
+   }
+
+   cout << "# Testing sparse inner and outer products in dim 64" << endl;
+   cout << "#-----------------------------------------------" << endl;
+   cout << "Inner time taken " << inner_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Outer time taken " << outer_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Reference time taken " << ref_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Max difference " << err << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   return err <= tolerance ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+#include <Mvec>
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace gca;
+
+/* True if building a blade on the basis e throws std::out_of_range */
+bool rejects(const vector<unsigned long> &e) {
+   try {
+      Blade b(1.0, e);
+   } catch (const out_of_range&) {
+      return true;
+   }
+   return false;
+}
+
+bool rejects(unsigned long e) {
+   try {
+      Blade b(1.0, e);
+   } catch (const out_of_range&) {
+      return true;
+   }
+   return false;
+}
+
+int main(int argc, char **argv) {
+
+   unsigned long top = bkey_t::maxDim < 1000 ? bkey_t::maxDim : 1000;
+   bool bounded = bkey_t::maxDim < 1000;
+
+   size_t wrong = 0;
+
+   /* Every index up to the width of the key is kept */
+   for (unsigned long e = 1; e <= top; e++) {
+      Blade b(2.0, e);
+      if (rejects(e) || b.grade() != 1 || b.key().top() != e) {
+         wrong++;
+      }
+   }
+   vector<unsigned long> e;
+   e.push_back(1);
+   e.push_back(top);
+   if (rejects(e) || Blade(1.0, e).grade() != 2) {
+      wrong++;
+   }
+
+   /* Indices past the width of a mask, and e0, are rejected */
+   if (bounded) {
+      e.push_back(top + 1);
+      if (!rejects(top + 1) || !rejects(top + 64) || !rejects(e)) {
+         wrong++;
+      }
+   }
+   if (!rejects(0)) {
+      wrong++;
+   }
+
+   /* Set words beyond the width of a mask are rejected, not dropped */
+   uint64_t w[17] = {0};
+   w[(top - 1) / 64] = ((uint64_t) 1) << ((top - 1) % 64);
+   if (bkey_t::fromWords(w, 17) != Blade(1.0, top).key()) {
+      wrong++;
+   }
+   if (bounded) {
+      w[16] = 1;
+      try {
+         bkey_t::fromWords(w, 17);
+         wrong++;
+      } catch (const out_of_range&) {
+      }
+   }
+
+   cout << "# Testing basis index bounds" << endl;
+   cout << "#-----------------------------------------------" << endl;
+   cout << "Largest index " << top << endl;
+   cout << "Wrong keys " << wrong << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   return wrong == 0 ? 0 : 1;
+}
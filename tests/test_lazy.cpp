@@ -0,0 +1,72 @@
+#include "test_genb.h"
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numTests = 100;
+
+int main(int argc, char **argv) {
+
+   vector<Mvec> mvecs;
+
+   srand(1);
+
+   for (unsigned int i = 0; i < numTests + 4; i++) {
+      mvecs.push_back(generate_mvec(50, 20));
+   }
+
+   double eager_secs = 0;
+   double lazy_secs = 0;
+   double err = 0;
+
+   for (size_t i = 0; i < numTests; i++) {
+      clock_t begin;
+      clock_t end;
+
+      const Mvec &A = mvecs[i];
+      const Mvec &B = mvecs[i + 1];
+      const Mvec &C = mvecs[i + 2];
+      const Mvec &D = mvecs[i + 3];
+      const Mvec &E = mvecs[i + 4];
+
+      begin = clock();
+      Mvec eager = A.mul(B).add(C.mul(D)).sub(E);
+      end = clock();
+      eager_secs += double(end - begin);
+
+      begin = clock();
+      Mvec lazy = A*B + C*D - E;
+      end = clock();
+      lazy_secs += double(end - begin);
+
+      err = max(err, difference(eager, lazy));
+
+      err = max(err, difference(A.add(B).mul(C.sub(D)), (A + B)*(C - D)));
+      err = max(err, difference(A.inner(B).conj(), ~(A & B)));
+      err = max(err, difference(A.outer(B).mul(2).add(C.div(4)), (A ^ B)*2.0 + C/4.0));
+      err = max(err, difference(A.mul(B)[2], (A*B)[2]));
+      err = max(err, difference(A.add(1.5), A + 1.5));
+      err = max(err, difference(A.add(B).mul(2).sub(C), (A + B)*2.0 - C));
+      err = max(err, difference(A.sub(A), A - A));
+
+      Mvec F = A;
+      F = F*B + F;
+      err = max(err, difference(A.mul(B).add(A), F));
+   }
+
+   cout << "# Testing A*B + C*D - E" << endl;
+   cout << "#-----------------------------------------------" << endl;
+   cout << "Eager time taken " << eager_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Lazy time taken " << lazy_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Max difference " << err << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   return err <= tolerance ? 0 : 1;
+}
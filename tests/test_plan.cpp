@@ -0,0 +1,124 @@
+#include "test_genb.h"
+#include <Mvec>
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numTests = 100;
+const unsigned int numReps = 1000;
+
+/* Same bases as m, with new coefficients */
+Mvec recoef(const Mvec &m) {
+   blades_t blades = m.blades();
+   for (size_t k = 0; k < blades.size(); k++) {
+      blades[k].set((double) (rand() % 200) - 100);
+   }
+   return Mvec(blades);
+}
+
+/* A*B summed blade pair by blade pair, outside the plan cache */
+Mvec uncached(const Mvec &A, const Mvec &B) {
+   Mvec m;
+   for (size_t i = 0; i < A.blades().size(); i++) {
+      for (size_t j = 0; j < B.blades().size(); j++) {
+         m += Mvec(A.blades()[i] & B.blades()[j]);
+         m += Mvec(A.blades()[i] ^ B.blades()[j]);
+      }
+   }
+   return m;
+}
+
+int main(int argc, char **argv) {
+
+   srand(1);
+
+   double mul_secs = 0;
+   double plan_secs = 0;
+   double err = 0;
+
+   for (unsigned int i = 0; i < numTests; i++) {
+      clock_t begin;
+      clock_t end;
+
+      /* Rotor times vector in dim 5 */
+      Mvec R = generate_mvec(32, 5)[2] + generate_mvec(32, 5)[4] + Mvec(1.0);
+      Mvec a = generate_mvec(32, 5)[1] + Mvec(1, 1);
+
+      vector<Mvec> Rs;
+      vector<Mvec> as;
+      for (unsigned int r = 0; r < numReps; r++) {
+         Rs.push_back(recoef(R));
+         as.push_back(recoef(a));
+      }
+
+      vector<Mvec> C(numReps);
+      begin = clock();
+      for (unsigned int r = 0; r < numReps; r++) {
+         C[r] = Rs[r] * as[r];
+      }
+      end = clock();
+      mul_secs += double(end - begin);
+
+      ProductPlan plan(R.blades(), a.blades(), PROD_MUL);
+      vector<double> cR(R.blades().size());
+      vector<double> ca(a.blades().size());
+      vector<double> c(plan.size());
+
+      begin = clock();
+      for (unsigned int r = 0; r < numReps; r++) {
+         for (size_t k = 0; k < cR.size(); k++) {
+            cR[k] = Rs[r].blades()[k].get();
+         }
+         for (size_t k = 0; k < ca.size(); k++) {
+            ca[k] = as[r].blades()[k].get();
+         }
+         plan.apply(&cR[0], &ca[0], &c[0]);
+      }
+      end = clock();
+      plan_secs += double(end - begin);
+
+      err = max(err, difference(C[numReps - 1],
+              uncached(Rs[numReps - 1], as[numReps - 1])));
+
+      /* Compare the last raw result with the cached product */
+      const blades_t &b = C[numReps - 1].blades();
+      size_t j = 0;
+      for (size_t k = 0; k < plan.size(); k++) {
+         if (fabs(c[k]) <= GCA_PRECISION) {
+            continue;
+         }
+         if (j >= b.size() || b[j].key() != plan.keys()[k]) {
+            err = max(err, 1.0);
+            break;
+         }
+         err = max(err, fabs(b[j].get() - c[k]));
+         j++;
+      }
+   }
+
+   /* Products with an empty operand stay empty once planned */
+   for (unsigned int r = 0; r < 3; r++) {
+      Mvec e;
+      Mvec v(2.0, 1);
+      if (!(e * v).blades().empty() || !(v * e).blades().empty() ||
+          !(e & v).blades().empty() || !(v ^ e).blades().empty()) {
+         err = max(err, 1.0);
+      }
+   }
+
+   cout << "# Testing repeated rotor*vector products in dim 5" << endl;
+   cout << "#-----------------------------------------------" << endl;
+   cout << "Mul time taken " << mul_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Raw plan time taken " << plan_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Max difference " << err << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   return err <= tolerance ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+#include "test_genb.h"
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numTests = 10;
+
+/* Exposes the canonicalization step so it can be timed on its own */
+class PruneMvec : public Mvec {
+public:
+
+   PruneMvec(const blades_t& blades) {
+      _blades = blades;
+   }
+
+   void canonicalize() {
+      this->prune();
+   }
+};
+
+int main(int argc, char **argv) {
+
+   double prune_time = 0;
+   double mul_time = 0;
+   double inner_time = 0;
+   double err = 0;
+   vector<Mvec> mvecs;
+
+   srand(1);
+
+   for (unsigned int i = 0; i < numTests; i++) {
+      mvecs.push_back(generate_mvec(100,58));
+   }
+
+   for (size_t i = 0; i < mvecs.size(); i++) {
+      for (size_t ii = 0; ii < mvecs.size(); ii++) {
+         clock_t begin;
+         clock_t end;
+
+         Mvec A = mvecs[i];
+         Mvec B = mvecs[ii];
+         Mvec C;
+
+         /* The raw pair products A*B has to canonicalize */
+         blades_t raw;
+         for (size_t j = 0; j < A.blades().size(); j++) {
+            for (size_t jj = 0; jj < B.blades().size(); jj++) {
+               raw.push_back(A.blades()[j] & B.blades()[jj]);
+               raw.push_back(A.blades()[j] ^ B.blades()[jj]);
+            }
+         }
+         PruneMvec P(raw);
+
+         begin = clock();
+         P.canonicalize();
+         end = clock();
+         prune_time += double(end - begin);
+
+         begin = clock();
+         C = A*B;
+         end = clock();
+         mul_time += double(end - begin);
+         err = max(err, difference(C, P));
+
+         begin = clock();
+         C = A&B;
+         end = clock();
+         inner_time += double(end - begin);
+      }
+   }
+
+   cout << "#-----------------------------------------------" << endl;
+   cout << "Prune time taken " << prune_time / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Mul time taken " << mul_time / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Inner time taken " << inner_time / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Max difference " << err << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   return err <= tolerance ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+#include "test_genb.h"
+#include <Reduce>
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numTerms = 5000;
+
+int main(int argc, char **argv) {
+
+   vector<Mvec> terms;
+   vector<Mvec> rotors;
+
+   srand(1);
+
+   for (unsigned int i = 0; i < numTerms; i++) {
+      terms.push_back(generate_mvec(20, 10));
+
+      /* Unit rotors in dim 3 */
+      Mvec R = generate_mvec(8, 3)[2] + Mvec(50.0);
+      rotors.push_back(R.div(sqrt(R.mag())));
+   }
+
+   clock_t begin;
+   clock_t end;
+
+   begin = clock();
+   Mvec S;
+   Mvec P(1.0);
+   for (unsigned int i = 0; i < numTerms; i++) {
+      S = S.add(terms[i]);
+      P = P.mul(rotors[i]);
+   }
+   end = clock();
+   double seq_secs = double(end - begin);
+
+   begin = clock();
+   Mvec rS = reduce_sum(terms);
+   Mvec rP = reduce_product(rotors);
+   end = clock();
+   double tree_secs = double(end - begin);
+
+   double err = max(difference(S, rS), difference(P, rP));
+
+   double threadErr = 0;
+#ifdef OMP_ENABLED
+   /* The tree doesn't depend on the number of threads */
+   for (int t = 1; t <= 4; t++) {
+      omp_set_num_threads(t);
+      Mvec tS = reduce_sum(terms);
+      Mvec tP = reduce_product(rotors);
+      for (size_t j = 0; j < tS.blades().size() && j < rS.blades().size(); j++) {
+         if (tS.blades()[j].get() != rS.blades()[j].get()) {
+            threadErr = 1;
+         }
+      }
+      for (size_t j = 0; j < tP.blades().size() && j < rP.blades().size(); j++) {
+         if (tP.blades()[j].get() != rP.blades()[j].get()) {
+            threadErr = 1;
+         }
+      }
+      threadErr = max(threadErr, difference(tS, rS) + difference(tP, rP));
+   }
+#endif
+
+   cout << "# Testing reduce_sum and reduce_product" << endl;
+   cout << "#-----------------------------------------------" << endl;
+   cout << "Sequential time taken " << seq_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Tree time taken " << tree_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Max difference " << err << endl;
+   cout << "Thread difference " << threadErr << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   return (err <= tolerance && threadErr == 0) ? 0 : 1;
+}
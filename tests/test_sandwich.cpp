@@ -0,0 +1,90 @@
+#include "test_genb.h"
+#include <Mvec>
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numTests = 200;
+const unsigned int numReps = 10;
+
+/* Unit vector of e1..en */
+Mvec unit_vector(unsigned int n) {
+   Mvec m = Mvec(1, 1 + rand() % n);
+   for (unsigned int k = 1; k <= n; k++) {
+      m = m + Mvec(rand() / (double) RAND_MAX - 0.5, k);
+   }
+   return m / sqrt(m.mag());
+}
+
+int main(int argc, char **argv) {
+
+   double maxErr = 0;
+
+   srand(1);
+
+   for (unsigned int n = 4; n <= 8; n += 4) {
+      double mul_secs = 0;
+      double sandwich_secs = 0;
+      double err = 0;
+      double reflect_err = 0;
+
+      for (unsigned int i = 0; i < numTests; i++) {
+         clock_t begin;
+         clock_t end;
+
+         Mvec v = unit_vector(n);
+         Mvec R = v * unit_vector(n) * unit_vector(n) * unit_vector(n);
+         Mvec Rc = ~R;
+         Mvec X = generate_mvec(12, n);
+         Mvec C;
+         Mvec S;
+
+         begin = clock();
+         for (unsigned int r = 0; r < numReps; r++) {
+            C = R * X * Rc;
+         }
+         end = clock();
+         mul_secs += double(end - begin);
+
+         begin = clock();
+         for (unsigned int r = 0; r < numReps; r++) {
+            S = Mvec::sandwich(R, X);
+         }
+         end = clock();
+         sandwich_secs += double(end - begin);
+
+         if (C.blades().size() != S.blades().size()) {
+            err = max(err, 1.0);
+         } else {
+            for (size_t k = 0; k < C.blades().size(); k++) {
+               double d = C.blades()[k].get() - S.blades()[k].get();
+               err = max(err, fabs(d) / sqrt(C.mag()));
+            }
+         }
+
+         /* A unit vector reflects x in the hyperplane orthogonal to it */
+         Mvec x = X[1];
+         Mvec h = versorApply(v, x);
+         Mvec hc = v * x * v * -1.0;
+         reflect_err = max(reflect_err, difference(hc, h));
+      }
+
+      cout << "# Testing sandwich R*X*~R in dim " << n << endl;
+      cout << "#-----------------------------------------------" << endl;
+      cout << "Mul time taken " << mul_secs / CLOCKS_PER_SEC << " s." << endl;
+      cout << "Sandwich time taken " << sandwich_secs / CLOCKS_PER_SEC << " s." << endl;
+      cout << "Max relative difference " << err << endl;
+      cout << "Max reflection difference " << reflect_err << endl;
+      cout << "#-----------------------------------------------" << endl;
+      maxErr = max(maxErr, max(err, reflect_err));
+   }
+
+   return maxErr <= tolerance ? 0 : 1;
+}
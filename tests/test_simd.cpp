@@ -0,0 +1,92 @@
+#include "test_genb.h"
+#include <DenseMvec>
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numTests = 100;
+const unsigned int numReps = 1000;
+
+double maxErr = 0;
+
+template<unsigned int N>
+void bench(void) {
+
+   vector<DenseMvec<N> > dvecs;
+
+   for (unsigned int i = 0; i < numTests; i++) {
+      dvecs.push_back(DenseMvec<N>(generate_mvec(DenseMvec<N>::size, N)));
+   }
+
+   cout << "# Testing dim " << N << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   vector<DenseMvec<N> > reference;
+   isa_t isas[3] = {ISA_SCALAR, ISA_AVX2, ISA_AVX512};
+
+   for (unsigned int s = 0; s < 3; s++) {
+      if (!setSimdIsa(isas[s])) {
+         cout << isaName(isas[s]) << " not supported" << endl;
+         continue;
+      }
+
+      double elapsed_secs = 0;
+      double err = 0;
+
+      for (size_t i = 0; i < numTests; i++) {
+         clock_t begin;
+         clock_t end;
+
+         DenseMvec<N> A = dvecs[i];
+         DenseMvec<N> B = dvecs[(i + 1) % numTests];
+         B = B * (1 / B.norm());
+         DenseMvec<N> C;
+         DenseMvec<N> D;
+
+         begin = clock();
+         for (unsigned int r = 0; r < numReps; r++) {
+            C = A*B;
+            D = (A&B) + (A^B);
+            A = A[r % (N + 1)] + C + D;
+            A = A * (1 / A.norm());
+         }
+         end = clock();
+         elapsed_secs += double(end - begin);
+
+         /* Compare one product of the original inputs to the scalar one */
+         A = dvecs[i];
+         C = A*B + (A&B)[1] + (A^B)[2];
+         if (s == 0) {
+            reference.push_back(C);
+         } else {
+            err = std::max(err, (C - reference[i]).norm() / reference[i].norm());
+         }
+      }
+
+      double ops = 3.0 * numTests * numReps;
+      cout << isaName(isas[s]) << " time taken " << elapsed_secs / CLOCKS_PER_SEC
+              << " s, " << ops / (elapsed_secs / CLOCKS_PER_SEC) << " products/s"
+              << ", relative difference " << err << endl;
+      maxErr = std::max(maxErr, err);
+   }
+
+   cout << "#-----------------------------------------------" << endl;
+}
+
+int main(int argc, char **argv) {
+
+   srand(1);
+
+   bench<3>();
+   bench<4>();
+   bench<5>();
+
+   return maxErr <= tolerance ? 0 : 1;
+}
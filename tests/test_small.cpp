@@ -0,0 +1,88 @@
+#include "test_genb.h"
+#include <Mvec>
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numTests = 100000;
+
+int main(int argc, char **argv) {
+
+   vector<Mvec> rotors;
+   vector<Mvec> vectors;
+
+   srand(1);
+
+   for (unsigned int i = 0; i < 64; i++) {
+      rotors.push_back(generate_mvec(8, 3)[2] + Mvec(1.0));
+      vectors.push_back(generate_mvec(8, 3)[1]);
+   }
+
+   clock_t begin;
+   clock_t end;
+
+   /* Copies of small multivectors */
+   allocStats().clear();
+   vector<Mvec> copies(rotors.size());
+   begin = clock();
+   for (unsigned int i = 0; i < numTests; i++) {
+      copies[i % copies.size()] = rotors[i % rotors.size()];
+   }
+   end = clock();
+   AllocStats copyStats = allocStats();
+   double copy_secs = double(end - begin);
+
+   /* Rotations of vectors in 3D */
+   allocStats().clear();
+   double sum = 0;
+   begin = clock();
+   for (unsigned int i = 0; i < numTests; i++) {
+      const Mvec &R = rotors[i % rotors.size()];
+      Mvec x = R * vectors[i % vectors.size()] * ~R;
+      sum += x.mag();
+   }
+   end = clock();
+   AllocStats rotStats = allocStats();
+   double rot_secs = double(end - begin);
+
+   cout << "# Testing small multivectors with " << GCA_INLINE_BLADES
+           << " inline blades" << endl;
+   cout << "#-----------------------------------------------" << endl;
+   cout << "Copy time taken " << copy_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Copy allocations " << copyStats.allocs << endl;
+   cout << "Rotation time taken " << rot_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Rotation allocations " << rotStats.allocs << endl;
+   cout << "Checksum " << sum << endl;
+
+   /* Code written against std::vector blade lists */
+   bool ok = true;
+   vector<Blade> list;
+   for (unsigned long e = 12; e >= 1; e--) {
+      list.push_back(Blade(double(e), e));
+   }
+   Mvec fromList(list);
+   Mvec fromRange(list.begin(), list.end());
+   blades_t b(list.begin(), list.begin() + 4);
+   b.insert(b.begin() + 2, list.begin() + 4, list.end());
+   b.insert(b.begin(), Blade(0.5, 13));
+   b.insert(b.end(), 2, Blade(0.25, 14));
+   b.erase(b.begin() + 1, b.begin() + 3);
+   ok = ok && b.size() == 13 && b.front().get() == 0.5 && b[1].get() == 8.0 &&
+           b.at(10).get() == 9.0 && b.back().get() == 0.25;
+   blades_t c(b.rbegin(), b.rend());
+   ok = ok && c.front().get() == 0.25 && c.back().get() == 0.5 && c != b;
+   ok = ok && fromList.blades().size() == 12 && fromList == fromRange;
+   vector<unsigned long> e = fromList.blades()[0].base();
+   ok = ok && e.size() == 1 && e[0] == 1;
+   cout << "Vector interface " << (ok ? "ok" : "FAILED") << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   return ok ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+#include "test_genb.h"
+#include <Store>
+
+#include <iostream>
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <sstream>
+#include <ctime>
+
+using namespace std;
+using namespace gca;
+
+const unsigned int numMvecs = 20000;
+const char *path = "test_store.gca";
+
+/* Exact comparison of keys and coefficients */
+bool same(const Mvec &a, const Mvec &b) {
+   if (a.blades().size() != b.blades().size()) {
+      return false;
+   }
+   for (size_t j = 0; j < a.blades().size(); j++) {
+      if (a.blades()[j].key() != b.blades()[j].key() ||
+          a.blades()[j].get() != b.blades()[j].get()) {
+         return false;
+      }
+   }
+   return true;
+}
+
+int main(int argc, char **argv) {
+
+   vector<Mvec> mvecs;
+
+   srand(1);
+
+   for (unsigned int i = 0; i < numMvecs; i++) {
+      /* Coefficients that text output would round */
+      mvecs.push_back(generate_mvec(10, 8).mul(1.0 / 3.0));
+   }
+   mvecs.push_back(Mvec());
+   mvecs.push_back(Mvec(1.0, 60));
+
+   clock_t begin;
+   clock_t end;
+
+   begin = clock();
+   MvecWriter out(path);
+   for (size_t i = 0; i < mvecs.size(); i++) {
+      out.write(mvecs[i]);
+   }
+   bool written = out.close();
+   end = clock();
+   double write_secs = double(end - begin);
+
+   begin = clock();
+   MvecStore store(path);
+   size_t wrong = store.size() == mvecs.size() ? 0 : 1;
+   for (size_t i = 0; i < store.size() && i < mvecs.size(); i++) {
+      if (!same(store.get(i), mvecs[i])) {
+         wrong++;
+      }
+   }
+   end = clock();
+   double read_secs = double(end - begin);
+
+   /* Products straight from the mapped records */
+   bool zeroCopy = store.zeroCopy();
+   size_t wrongProducts = 0;
+   begin = clock();
+   if (zeroCopy) {
+      for (size_t i = 0; i + 1 < numMvecs; i += 2) {
+         MvecView a = store.view(i);
+         MvecView b = store.view(i + 1);
+         if (!same(a.mul(b), mvecs[i] * mvecs[i + 1]) ||
+             !same(a.inner(mvecs[i + 1].blades()), mvecs[i] & mvecs[i + 1]) ||
+             !same(a.outer(b), mvecs[i] ^ mvecs[i + 1])) {
+            wrongProducts++;
+         }
+      }
+   }
+   end = clock();
+   double view_secs = double(end - begin);
+
+   /* Out of range reads and incomplete or foreign files */
+   size_t wrongChecks = 0;
+   if (!store.view(store.size()).empty() || !store.get(store.size()).blades().empty()) {
+      wrongChecks++;
+   }
+   store.close();
+
+   /* Keys wider than this build's are rejected, not truncated */
+   {
+      MvecWriter wide(path, 9);
+      wide.write(mvecs[0]);
+   }
+   if (MvecStore(path).isOpen() != (bkey_t::maxDim >= 64 * 9)) {
+      wrongChecks++;
+   }
+
+   MvecWriter narrow(path, 0);
+   if (narrow.ok() || narrow.close()) {
+      wrongChecks++;
+   }
+   {
+      MvecWriter partial(path);
+      partial.write(mvecs[0]);
+      if (MvecStore(path).isOpen()) {
+         wrongChecks++;
+      }
+   }
+   if (!MvecStore(path).isOpen()) {
+      wrongChecks++;
+   }
+   FILE *f = fopen(path, "wb");
+   fputs(mvecs[0].toString().c_str(), f);
+   fclose(f);
+   if (MvecStore(path).isOpen() || MvecStore("no/such/file").isOpen()) {
+      wrongChecks++;
+   }
+   remove(path);
+
+   cout << "# Testing MvecWriter and MvecStore" << endl;
+   cout << "#-----------------------------------------------" << endl;
+   cout << "Written " << (written ? "yes" : "no") << endl;
+   cout << "Zero copy " << (zeroCopy ? "yes" : "no") << endl;
+   cout << "Write time taken " << write_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Read time taken " << read_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "View product time taken " << view_secs / CLOCKS_PER_SEC << " s." << endl;
+   cout << "Wrong reads " << wrong << endl;
+   cout << "Wrong products " << wrongProducts << endl;
+   cout << "Wrong checks " << wrongChecks << endl;
+   cout << "#-----------------------------------------------" << endl;
+
+   return (written && wrong == 0 && wrongProducts == 0 && wrongChecks == 0) ? 0 : 1;
+}